@@ -0,0 +1,838 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "AtlasManager.h"
+#include "FontTrace.h"
+//-------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+//-------------------------------------
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define ATLAS_USE_MMAP
+#endif
+
+using namespace MindShake;
+
+//-------------------------------------
+// Address space reserved once and committed on demand (zero filled).
+// Without virtual memory support the whole range is allocated up front.
+//-------------------------------------
+
+//-------------------------------------
+static size_t
+GetMemoryPageSize() {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return size_t(info.dwPageSize);
+#elif defined(ATLAS_USE_MMAP)
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? size_t(size) : 4096;
+#else
+    return 1;
+#endif
+}
+
+//-------------------------------------
+static uint8_t *
+ReserveMemory(size_t size) {
+#if defined(_WIN32)
+    return (uint8_t *) VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#elif defined(ATLAS_USE_MMAP)
+    void *ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr != MAP_FAILED ? (uint8_t *) ptr : nullptr;
+#else
+    return (uint8_t *) calloc(size, 1);
+#endif
+}
+
+//-------------------------------------
+static bool
+CommitMemory(uint8_t *base, size_t from, size_t to) {
+#if defined(_WIN32)
+    return VirtualAlloc(base + from, to - from, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#elif defined(ATLAS_USE_MMAP)
+    return mprotect(base + from, to - from, PROT_READ | PROT_WRITE) == 0;
+#else
+    return true;
+#endif
+}
+
+//-------------------------------------
+static void
+ReleaseMemory(uint8_t *base, size_t size) {
+#if defined(_WIN32)
+    VirtualFree(base, 0, MEM_RELEASE);
+#elif defined(ATLAS_USE_MMAP)
+    munmap(base, size);
+#else
+    free(base);
+#endif
+}
+
+//-------------------------------------
+AtlasManager::~AtlasManager() {
+    CancelCompact();
+    FreePages();
+}
+
+//-------------------------------------
+bool
+AtlasManager::Init(uint32_t pageWidth, uint32_t pageHeight, uint32_t initialPageHeight, FontAllocator *allocator) {
+    CancelCompact();
+    FreePages();
+
+    mTextureAllocator = allocator;
+
+    // The containers move to the allocator
+    mAllocator              = allocator != nullptr ? allocator : FontAllocator::GetDefault();
+    mPages                  = FontVector<Page>(FontVector<Page>::allocator_type(mAllocator));
+    mCompact.pending        = FontVector<Placement>(FontVector<Placement>::allocator_type(mAllocator));
+    mCompact.pages          = FontVector<Page>(FontVector<Page>::allocator_type(mAllocator));
+    mCompact.textureHeights = FontVector<uint32_t>(FontVector<uint32_t>::allocator_type(mAllocator));
+    mDirtyRegions           = FontVector<DirtyRegion>(FontVector<DirtyRegion>::allocator_type(mAllocator));
+
+    mPageWidth         = pageWidth;
+    mPageHeight        = pageHeight;
+    mInitialPageHeight = std::min(initialPageHeight, pageHeight);
+
+    if(AddPage(mInitialPageHeight) == false)
+        return false;
+    mNumResizes = 0;
+
+    return true;
+}
+
+//-------------------------------------
+void
+AtlasManager::SetAllowRotation(bool set) {
+    mAllowRotation = set;
+    for(auto &page : mPages) {
+        page.packer.SetAllowRotation(set);
+    }
+}
+
+//-------------------------------------
+void
+AtlasManager::SetUseWasteMap(bool set) {
+    mUseWasteMap = set;
+    for(auto &page : mPages) {
+        page.packer.SetUseWasteMap(set);
+    }
+}
+
+//-------------------------------------
+bool
+AtlasManager::Allocate(AtlasClient *client, uint64_t key, uint32_t width, uint32_t height, uint32_t *pPage, Rect *pRect, bool *pRotated) {
+    FONT_TRACE_SCOPE("AtlasAllocate", "width", width, "height", height);
+
+    Rect    rect;
+
+    if(width == 0 || height == 0)
+        return false;
+
+    if((width > mPageWidth || height > mPageHeight) && (mAllowRotation == false || height > mPageWidth || width > mPageHeight))
+        return false;
+
+    uint32_t page = 0;
+    for( ; page < mPages.size(); ++page) {
+        rect = mPages[page].packer.Insert(width, height, mHeuristic);
+        if(rect.width > 0)
+            break;
+    }
+
+    // Grow the pages that still can
+    if(page == mPages.size()) {
+        for(page = 0; page < mPages.size(); ++page) {
+            while(GrowPage(page)) {
+                rect = mPages[page].packer.Insert(width, height, mHeuristic);
+                if(rect.width > 0)
+                    break;
+            }
+            if(rect.width > 0)
+                break;
+        }
+    }
+
+    if(page == mPages.size()) {
+        if(AddPage(mInitialPageHeight) == false)
+            return false;
+
+        do {
+            rect = mPages[page].packer.Insert(width, height, mHeuristic);
+        } while(rect.width <= 0 && GrowPage(page));
+
+        if(rect.width <= 0)
+            return false;
+    }
+
+    mPages[page].regions.push_back({ client, key, rect });
+    mPages[page].liveArea += width * height;
+    AddDirtyRegion(page, rect);
+
+    if(mCompact.active) {
+        mCompact.pending.push_back({ mPages[page].regions.back(), page });
+    }
+
+    *pPage = page;
+    *pRect = rect;
+    if(pRotated != nullptr) {
+        *pRotated = uint32_t(rect.width) != width;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+bool
+AtlasManager::AllocateBatch(AtlasClient *client, FontVector<BatchRegion> &regions) {
+    FONT_TRACE_SCOPE("AtlasAllocateBatch", "regions", int64_t(regions.size()));
+
+    FontVector<size_t>          order(regions.size(), 0, FontVector<size_t>::allocator_type(mAllocator));
+    FontVector<SkylineBinPack>  packers { FontVector<SkylineBinPack>::allocator_type(mAllocator) };
+    size_t                      numPages = mPages.size();
+    bool                        allocated = true;
+
+    for(size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&regions](size_t a, size_t b) {
+        if(regions[a].height != regions[b].height)
+            return regions[a].height > regions[b].height;
+        return regions[a].width > regions[b].width;
+    });
+
+    // Plan on copies of the packers: nothing changes if we run out of memory
+    for(const auto &page : mPages) {
+        packers.push_back(page.packer);
+    }
+
+    for(size_t index : order) {
+        BatchRegion &region = regions[index];
+
+        region.allocated = InsertGrowing(packers, region.width, region.height, &region.page, &region.rect);
+        if(region.allocated == false) {
+            allocated = false;
+            continue;
+        }
+        region.rotated = uint32_t(region.rect.width) != region.width;
+    }
+
+    // One commit per page (rows committed in vain are just zeros waiting for the packer)
+    FontVector<Page> newPages { FontVector<Page>::allocator_type(mAllocator) };
+    for(size_t p = numPages; p < packers.size(); ++p) {
+        newPages.emplace_back(mAllocator);
+    }
+    for(size_t p = 0; p < packers.size(); ++p) {
+        bool ok = p < numPages ? CommitTexture(mPages[p], packers[p].GetHeight()) : NewTexture(newPages[p - numPages], packers[p].GetHeight());
+        if(ok == false) {
+            FreePages(newPages);
+            for(auto &region : regions) {
+                region.allocated = false;
+            }
+            return false;
+        }
+    }
+
+    for(uint32_t p = 0; p < packers.size(); ++p) {
+        uint32_t oldHeight = 0;
+        if(p >= numPages) {
+            mPages.push_back(std::move(newPages[p - numPages]));
+        }
+        else {
+            oldHeight = mPages[p].packer.GetHeight();
+        }
+        mPages[p].packer = std::move(packers[p]);
+        if(uint32_t(mPages[p].packer.GetHeight()) != oldHeight) {
+            ++mNumResizes;
+        }
+        AddDirtyPage(p, oldHeight);
+    }
+
+    for(const auto &region : regions) {
+        if(region.allocated == false)
+            continue;
+
+        Page &page = mPages[region.page];
+        page.regions.push_back({ client, region.key, region.rect });
+        page.liveArea += region.width * region.height;
+        AddDirtyRegion(region.page, region.rect);
+
+        if(mCompact.active) {
+            mCompact.pending.push_back({ page.regions.back(), region.page });
+        }
+    }
+
+    return allocated;
+}
+
+//-------------------------------------
+// Same policy as Allocate (existing pages, then growing them, then a new page) without touching the textures
+bool
+AtlasManager::InsertGrowing(FontVector<SkylineBinPack> &packers, uint32_t width, uint32_t height, uint32_t *pPage, Rect *pRect) {
+    Rect rect;
+
+    if(width == 0 || height == 0)
+        return false;
+
+    if((width > mPageWidth || height > mPageHeight) && (mAllowRotation == false || height > mPageWidth || width > mPageHeight))
+        return false;
+
+    auto grow = [this](SkylineBinPack &packer) {
+        uint32_t newHeight = std::min(uint32_t(packer.GetHeight()) << 1, mPageHeight);
+        if(newHeight <= uint32_t(packer.GetHeight()))
+            return false;
+        return packer.ResizeBin(mPageWidth, newHeight);
+    };
+
+    uint32_t page = 0;
+    for( ; page < packers.size(); ++page) {
+        rect = packers[page].Insert(width, height, mHeuristic);
+        if(rect.width > 0)
+            break;
+    }
+
+    if(page == packers.size()) {
+        for(page = 0; page < packers.size(); ++page) {
+            while(grow(packers[page])) {
+                rect = packers[page].Insert(width, height, mHeuristic);
+                if(rect.width > 0)
+                    break;
+            }
+            if(rect.width > 0)
+                break;
+        }
+    }
+
+    if(page == packers.size()) {
+        packers.emplace_back(mPageWidth, mInitialPageHeight, mAllowRotation, mUseWasteMap, mAllocator);
+        do {
+            rect = packers[page].Insert(width, height, mHeuristic);
+        } while(rect.width <= 0 && grow(packers[page]));
+
+        if(rect.width <= 0) {
+            packers.pop_back();
+            return false;
+        }
+    }
+
+    *pPage = page;
+    *pRect = rect;
+
+    return true;
+}
+
+//-------------------------------------
+template <typename Predicate>
+void
+AtlasManager::ReleaseIf(const Predicate &isReleased) {
+    auto releaseRegions = [&isReleased](Page &page) {
+        auto it = std::partition(page.regions.begin(), page.regions.end(), [&isReleased](const Region &region) { return isReleased(region) == false; });
+        if(it == page.regions.end())
+            return false;
+
+        for(auto released = it; released != page.regions.end(); ++released) {
+            page.liveArea -= released->rect.width * released->rect.height;
+        }
+        page.regions.erase(it, page.regions.end());
+
+        return true;
+    };
+
+    if(mCompact.active) {
+        auto &pending = mCompact.pending;
+        pending.erase(std::remove_if(pending.begin() + mCompact.next, pending.end(), [&isReleased](const Placement &placement) { return isReleased(placement.region); }), pending.end());
+        for(auto &page : mCompact.pages) {
+            releaseRegions(page);
+        }
+    }
+
+    for(uint32_t p = 0; p < mPages.size(); ++p) {
+        Page &page = mPages[p];
+        if(releaseRegions(page) && page.regions.empty()) {
+            page.packer.Reset();
+            memset(page.texture, 0, mPageWidth * page.packer.GetHeight());
+            AddDirtyPage(p);
+        }
+    }
+}
+
+//-------------------------------------
+void
+AtlasManager::Release(AtlasClient *client) {
+    ReleaseIf([client](const Region &region) {
+        return region.client == client;
+    });
+}
+
+//-------------------------------------
+void
+AtlasManager::Release(AtlasClient *client, FontVector<uint64_t> keys) {
+    std::sort(keys.begin(), keys.end());
+
+    ReleaseIf([client, &keys](const Region &region) {
+        return region.client == client && std::binary_search(keys.begin(), keys.end(), region.key);
+    });
+}
+
+//-------------------------------------
+bool
+AtlasManager::Compact() {
+    BeginCompact();
+    StepCompact(0.0f);
+
+    return mCompact.failed == false;
+}
+
+//-------------------------------------
+void
+AtlasManager::BeginCompact() {
+    CancelCompact();
+
+    for(uint32_t p = 0; p < mPages.size(); ++p) {
+        for(const auto &region : mPages[p].regions) {
+            mCompact.pending.push_back({ region, p });
+        }
+    }
+
+    // Tallest first packs better
+    std::sort(mCompact.pending.begin(), mCompact.pending.end(), [](const Placement &a, const Placement &b) {
+        if(a.region.rect.height != b.region.rect.height)
+            return a.region.rect.height > b.region.rect.height;
+        return a.region.rect.width > b.region.rect.width;
+    });
+
+    mCompact.next   = 0;
+    mCompact.active = true;
+    mCompact.failed = false;
+}
+
+//-------------------------------------
+bool
+AtlasManager::StepCompact(float timeBudgetMs) {
+    using Clock = std::chrono::steady_clock;
+
+    if(mCompact.active == false)
+        return true;
+
+    FONT_TRACE_SCOPE("AtlasStepCompact");
+    auto start = Clock::now();
+    while(mCompact.next < mCompact.pending.size()) {
+        if(PlaceRegion(mCompact.pending[mCompact.next]) == false) {
+            CancelCompact();
+            mCompact.failed = true;
+            return true;
+        }
+        ++mCompact.next;
+
+        if(timeBudgetMs > 0.0f && (mCompact.next & 15) == 0) {
+            std::chrono::duration<float, std::milli> elapsed = Clock::now() - start;
+            if(elapsed.count() >= timeBudgetMs)
+                return false;
+        }
+    }
+
+    FinishCompact();
+
+    return true;
+}
+
+//-------------------------------------
+void
+AtlasManager::CancelCompact() {
+    FreePages(mCompact.pages);
+    mCompact.pending.clear();
+    mCompact.textureHeights.clear();
+    mCompact.next   = 0;
+    mCompact.active = false;
+}
+
+//-------------------------------------
+bool
+AtlasManager::PlaceRegion(const Placement &placement) {
+    const Rect  &src = placement.region.rect;
+    auto        &pages = mCompact.pages;
+    Rect        rect;
+
+    uint32_t page = 0;
+    for( ; page < pages.size(); ++page) {
+        rect = pages[page].packer.Insert(src.width, src.height, ELevelChoiceHeuristic::LevelMinWasteFit);
+        if(rect.width > 0)
+            break;
+    }
+
+    if(page == pages.size()) {
+        Page newPage(mAllocator);
+        newPage.packer.Init(mPageWidth, mPageHeight, false, mUseWasteMap);    // Without rotation the regions keep their orientation
+        if(NewTexture(newPage, mInitialPageHeight) == false)
+            return false;
+        pages.push_back(std::move(newPage));
+        mCompact.textureHeights.push_back(mInitialPageHeight);
+
+        rect = pages[page].packer.Insert(src.width, src.height, ELevelChoiceHeuristic::LevelMinWasteFit);
+        if(rect.width <= 0)
+            return false;
+    }
+
+    // Only the height in use is committed (in steps of initialPageHeight * 2^n)
+    Page        &dst = pages[page];
+    uint32_t    &textureHeight = mCompact.textureHeights[page];
+    if(uint32_t(rect.bottom()) > textureHeight) {
+        uint32_t height = textureHeight;
+        while(height < uint32_t(rect.bottom()))
+            height <<= 1;
+        height = std::min(height, mPageHeight);
+
+        if(CommitTexture(dst, height) == false)
+            return false;
+
+        textureHeight = height;
+    }
+
+    const uint8_t *srcTexture = mPages[placement.srcPage].texture;
+    size_t srcOffset = src.y * mPageWidth + src.x;
+    size_t dstOffset = rect.y * mPageWidth + rect.x;
+    for(int y=0; y<src.height; ++y) {
+        memcpy(&dst.texture[dstOffset], &srcTexture[srcOffset], src.width);
+        srcOffset += mPageWidth;
+        dstOffset += mPageWidth;
+    }
+
+    dst.regions.push_back({ placement.region.client, placement.region.key, rect });
+    dst.liveArea += src.width * src.height;
+
+    return true;
+}
+
+//-------------------------------------
+void
+AtlasManager::FinishCompact() {
+    auto &pages = mCompact.pages;
+
+    // Regions released meanwhile can leave pages empty
+    for(size_t p = pages.size(); p-- > 0; ) {
+        if(pages[p].regions.empty() == false)
+            continue;
+
+        if(pages.size() > 1) {
+            FreeTexture(pages[p]);
+            pages.erase(pages.begin() + p);
+            mCompact.textureHeights.erase(mCompact.textureHeights.begin() + p);
+        }
+        else {
+            pages[p].packer.Reset();
+            memset(pages[p].texture, 0, pages[p].committed);
+            mCompact.textureHeights[p] = mInitialPageHeight;
+        }
+    }
+
+    if(pages.empty()) {
+        Page newPage(mAllocator);
+        newPage.packer.Init(mPageWidth, mPageHeight, false, mUseWasteMap);
+        if(NewTexture(newPage, mInitialPageHeight) == false) {
+            CancelCompact();
+            mCompact.failed = true;
+            return;
+        }
+        pages.push_back(std::move(newPage));
+        mCompact.textureHeights.push_back(mInitialPageHeight);
+    }
+
+    for(size_t p = 0; p < pages.size(); ++p) {
+        pages[p].packer.ShrinkBin(mCompact.textureHeights[p]);
+        pages[p].packer.SetAllowRotation(mAllowRotation);
+    }
+
+    FreePages();
+    mPages = std::move(pages);
+    pages.clear();
+    CancelCompact();
+
+    // Everything moved
+    mDirtyRegions.clear();
+    for(uint32_t p = 0; p < mPages.size(); ++p) {
+        AddDirtyPage(p);
+    }
+
+    for(uint32_t p = 0; p < mPages.size(); ++p) {
+        for(const auto &region : mPages[p].regions) {
+            region.client->OnAtlasRegionMoved(region.key, p, region.rect);
+        }
+    }
+}
+
+//-------------------------------------
+bool
+AtlasManager::Validate() const {
+    FontVector<uint8_t> used { FontVector<uint8_t>::allocator_type(mAllocator) };
+
+    for(uint32_t p = 0; p < mPages.size(); ++p) {
+        const Page  &page   = mPages[p];
+        uint32_t    height  = page.packer.GetHeight();
+        uint64_t    area    = 0;
+
+        if(page.packer.Validate() == false) {
+            fprintf(stderr, "Atlas page %u: invalid skyline\n", p);
+            return false;
+        }
+        if(page.texture == nullptr || page.committed < size_t(mPageWidth) * height || height > mPageHeight) {
+            fprintf(stderr, "Atlas page %u: texture of %zu bytes for %u rows\n", p, page.committed, height);
+            return false;
+        }
+
+        used.assign(size_t(mPageWidth) * height, 0);
+        for(const auto &region : page.regions) {
+            const Rect &rect = region.rect;
+            if(rect.width <= 0 || rect.height <= 0 || rect.x < 0 || rect.y < 0 || uint32_t(rect.right()) > mPageWidth || uint32_t(rect.bottom()) > height) {
+                fprintf(stderr, "Atlas page %u: region %d,%d %dx%d out of the page\n", p, rect.x, rect.y, rect.width, rect.height);
+                return false;
+            }
+            if(page.packer.OverlapsFreeSpace(rect)) {
+                fprintf(stderr, "Atlas page %u: region %d,%d %dx%d is free space for the packer\n", p, rect.x, rect.y, rect.width, rect.height);
+                return false;
+            }
+            for(int32_t y = rect.y; y < rect.bottom(); ++y) {
+                for(int32_t x = rect.x; x < rect.right(); ++x) {
+                    if(used[y * mPageWidth + x]++ != 0) {
+                        fprintf(stderr, "Atlas page %u: region %d,%d %dx%d overlaps another one\n", p, rect.x, rect.y, rect.width, rect.height);
+                        return false;
+                    }
+                }
+            }
+            area += uint64_t(rect.width) * rect.height;
+        }
+
+        if(area != page.liveArea) {
+            fprintf(stderr, "Atlas page %u: live area %llu, regions %llu\n", p, (unsigned long long) page.liveArea, (unsigned long long) area);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//-------------------------------------
+FontVector<AtlasManager::DirtyRegion>
+AtlasManager::ConsumeDirtyRegions() {
+    FontVector<DirtyRegion> regions { FontVector<DirtyRegion>::allocator_type(mAllocator) };
+
+    regions.swap(mDirtyRegions);
+
+    return regions;
+}
+
+//-------------------------------------
+void
+AtlasManager::AddDirtyRegion(uint32_t page, const Rect &rect) {
+    static const size_t kMaxRectsPerPage = 32;
+
+    auto contains = [](const Rect &a, const Rect &b) {
+        return a.x <= b.x && a.y <= b.y && a.right() >= b.right() && a.bottom() >= b.bottom();
+    };
+
+    size_t count = 0;
+    for(const auto &dirty : mDirtyRegions) {
+        if(dirty.page != page)
+            continue;
+        if(contains(dirty.rect, rect))
+            return;
+        ++count;
+    }
+
+    // Too many small rects: a single upload of their bounding box is cheaper
+    Rect bounds = rect;
+    if(count >= kMaxRectsPerPage) {
+        for(const auto &dirty : mDirtyRegions) {
+            if(dirty.page != page)
+                continue;
+            int32_t right  = std::max(bounds.right(),  dirty.rect.right());
+            int32_t bottom = std::max(bounds.bottom(), dirty.rect.bottom());
+            bounds.x      = std::min(bounds.x, dirty.rect.x);
+            bounds.y      = std::min(bounds.y, dirty.rect.y);
+            bounds.width  = right  - bounds.x;
+            bounds.height = bottom - bounds.y;
+        }
+    }
+
+    mDirtyRegions.erase(std::remove_if(mDirtyRegions.begin(), mDirtyRegions.end(), [&](const DirtyRegion &dirty) {
+        return dirty.page == page && contains(bounds, dirty.rect);
+    }), mDirtyRegions.end());
+
+    mDirtyRegions.push_back({ page, bounds });
+}
+
+//-------------------------------------
+// Rows from fromY to the current height of the page
+void
+AtlasManager::AddDirtyPage(uint32_t page, uint32_t fromY) {
+    uint32_t height = mPages[page].packer.GetHeight();
+
+    if(fromY < height) {
+        AddDirtyRegion(page, Rect(0, int32_t(fromY), int32_t(mPageWidth), int32_t(height - fromY)));
+    }
+}
+
+//-------------------------------------
+AtlasManager::Stats
+AtlasManager::GetStats() const {
+    Stats   stats {};
+
+    stats.numPages   = uint32_t(mPages.size());
+    stats.numResizes = mNumResizes;
+    for(const auto &page : mPages) {
+        stats.numRegions   += uint32_t(page.regions.size());
+        stats.textureBytes += uint64_t(mPageWidth) * page.packer.GetHeight();
+        stats.usedBytes    += uint64_t(mPageWidth) * page.packer.GetUsedHeight();
+        stats.usedArea     += page.packer.GetUsedSurfaceArea();
+        stats.liveArea     += page.liveArea;
+    }
+
+    return stats;
+}
+
+//-------------------------------------
+float
+AtlasManager::GetOccupancy() const {
+    Stats stats = GetStats();
+
+    if(stats.textureBytes == 0)
+        return 0.0f;
+
+    return float(double(stats.liveArea) / double(stats.textureBytes));
+}
+
+//-------------------------------------
+bool
+AtlasManager::AddPage(uint32_t height) {
+    Page page(mAllocator);
+
+    page.packer.Init(mPageWidth, height, mAllowRotation, mUseWasteMap);
+    if(NewTexture(page, height) == false)
+        return false;
+
+    mPages.push_back(std::move(page));
+    AddDirtyPage(uint32_t(mPages.size() - 1));
+    ++mNumResizes;
+
+    return true;
+}
+
+//-------------------------------------
+bool
+AtlasManager::GrowPage(uint32_t index) {
+    Page     &page     = mPages[index];
+    uint32_t height    = page.packer.GetHeight();
+    uint32_t newHeight = std::min(height << 1, mPageHeight);
+
+    if(newHeight <= height)
+        return false;
+
+    FONT_TRACE_SCOPE("AtlasGrowPage", "height", newHeight);
+    if(CommitTexture(page, newHeight) == false)
+        return false;
+
+    page.packer.ResizeBin(mPageWidth, newHeight);
+    AddDirtyPage(index, height);
+    ++mNumResizes;
+
+    return true;
+}
+
+//-------------------------------------
+void
+AtlasManager::FreePages() {
+    FreePages(mPages);
+}
+
+//-------------------------------------
+void
+AtlasManager::FreePages(FontVector<Page> &pages) {
+    for(auto &page : pages) {
+        FreeTexture(page);
+    }
+    pages.clear();
+}
+
+//-------------------------------------
+bool
+AtlasManager::NewTexture(Page &page, uint32_t height) {
+    static const size_t memoryPageSize = GetMemoryPageSize();
+
+    size_t size = size_t(mPageWidth) * mPageHeight;
+
+    // Whole page up front
+    if(mTextureAllocator != nullptr) {
+        page.texture = static_cast<uint8_t *>(mTextureAllocator->Allocate(size));
+        if(page.texture == nullptr) {
+            fprintf(stderr, "Not enough memory\n");
+            return false;
+        }
+        memset(page.texture, 0, size);
+        page.reserved  = size;
+        page.committed = size;
+        return true;
+    }
+
+    size = (size + memoryPageSize - 1) / memoryPageSize * memoryPageSize;
+
+    page.texture = ReserveMemory(size);
+    if(page.texture == nullptr) {
+        fprintf(stderr, "Not enough memory\n");
+        return false;
+    }
+    page.reserved  = size;
+    page.committed = 0;
+
+    if(CommitTexture(page, height) == false) {
+        FreeTexture(page);
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+bool
+AtlasManager::CommitTexture(Page &page, uint32_t height) {
+    static const size_t memoryPageSize = GetMemoryPageSize();
+
+    size_t size = size_t(mPageWidth) * height;
+    if(size <= page.committed)
+        return true;
+
+    size = std::min((size + memoryPageSize - 1) / memoryPageSize * memoryPageSize, page.reserved);
+    if(CommitMemory(page.texture, page.committed, size) == false) {
+        fprintf(stderr, "Not enough memory\n");
+        return false;
+    }
+    page.committed = size;
+
+    return true;
+}
+
+//-------------------------------------
+void
+AtlasManager::FreeTexture(Page &page) {
+    if(page.texture != nullptr) {
+        if(mTextureAllocator != nullptr)
+            mTextureAllocator->Free(page.texture, page.reserved);
+        else
+            ReleaseMemory(page.texture, page.reserved);
+    }
+    page.texture   = nullptr;
+    page.reserved  = 0;
+    page.committed = 0;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontAllocator.h"
+#include "SkylineBinPack.h"
+//-------------------------------------
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Whoever allocates regions in an AtlasManager is told when they are moved.
+    class AtlasClient {
+        public:
+            using Rect = SkylineBinPack::Rect;
+
+        public:
+            virtual                     ~AtlasClient() = default;
+
+            virtual void                OnAtlasRegionMoved(uint64_t key, uint32_t page, const Rect &rect) = 0;
+    };
+
+    //---------------------------------
+    // Set of 8 bit texture pages (all of the same width) shared by several clients.
+    // Pages start at initialPageHeight and double their height up to pageHeight,
+    // then a new page is created.
+    // Each page reserves the address space of pageHeight rows and commits memory as it grows,
+    // so growing does not copy the texture and its pointer stays valid (only compacting changes it).
+    // With an allocator the pages are allocated at their full height instead.
+    class AtlasManager {
+        public:
+            using Rect                   = SkylineBinPack::Rect;
+            using ELevelChoiceHeuristic  = SkylineBinPack::ELevelChoiceHeuristic;
+
+            struct Stats {
+                uint32_t    numPages;
+                uint32_t    numRegions;
+                uint32_t    numResizes;     // Pages grown or added since Init
+                uint64_t    textureBytes;   // Memory of all the pages
+                uint64_t    usedBytes;      // Memory up to the highest region of each page
+                uint64_t    usedArea;       // Pixels of the packed regions (live and released)
+                uint64_t    liveArea;       // Pixels of the live regions
+            };
+
+            struct BatchRegion {
+                uint64_t    key;
+                uint32_t    width;
+                uint32_t    height;
+                // Filled by AllocateBatch
+                uint32_t    page;
+                Rect        rect;
+                bool        rotated;
+                bool        allocated;
+            };
+
+            // Area of a page whose pixels changed
+            struct DirtyRegion {
+                uint32_t    page;
+                Rect        rect;
+            };
+
+        public:
+                                        AtlasManager() = default;           // Without pages until Init
+                                        AtlasManager(uint32_t pageWidth, uint32_t pageHeight, uint32_t initialPageHeight, FontAllocator *allocator = nullptr)  { Init(pageWidth, pageHeight, initialPageHeight, allocator); }
+                                        ~AtlasManager();
+
+                                        AtlasManager(const AtlasManager &) = delete;
+            AtlasManager &              operator = (const AtlasManager &) = delete;
+
+            // (Re)initializes the manager with just one empty page. The textures, the packers and the containers come from
+            // the allocator if given (otherwise from virtual memory and the default FontAllocator).
+            bool                        Init(uint32_t pageWidth, uint32_t pageHeight, uint32_t initialPageHeight, FontAllocator *allocator = nullptr);
+
+            // How new regions are packed. With rotation a region can come back as height x width (pRotated).
+            // Repacking keeps the orientation of the regions.
+            void                        SetHeuristic(ELevelChoiceHeuristic heuristic)   { mHeuristic = heuristic;          }
+            ELevelChoiceHeuristic       GetHeuristic() const                { return mHeuristic;                                                        }
+            void                        SetAllowRotation(bool set);
+            bool                        GetAllowRotation() const            { return mAllowRotation;                                                    }
+            void                        SetUseWasteMap(bool set);
+            bool                        GetUseWasteMap() const              { return mUseWasteMap;                                                      }
+
+            // Packs a region of width x height for the client. The key is given back in OnAtlasRegionMoved.
+            bool                        Allocate(AtlasClient *client, uint64_t key, uint32_t width, uint32_t height, uint32_t *pPage, Rect *pRect, bool *pRotated = nullptr);
+            // Packs several regions at once, tallest first. The page textures are resized once at the end.
+            // Returns false if some region could not be allocated (see BatchRegion::allocated).
+            bool                        AllocateBatch(AtlasClient *client, FontVector<BatchRegion> &regions);
+            // Forgets all the regions of the client (pages left empty are cleared to be reused)
+            void                        Release(AtlasClient *client);
+            // Forgets some regions of the client. Their space is recovered when compacting.
+            void                        Release(AtlasClient *client, FontVector<uint64_t> keys);
+
+            // Repacks the live regions in as few (and as short) pages as possible
+            bool                        Compact();
+
+            // Same as Compact but spread over several calls (e.g. one per frame).
+            // The current pages keep working until the last step swaps them with the new ones.
+            // Regions allocated or released meanwhile are taken into account.
+            void                        BeginCompact();
+            // Works at most timeBudgetMs (<= 0 means until done). Returns true when there is nothing left to do.
+            bool                        StepCompact(float timeBudgetMs);
+            void                        CancelCompact();
+            bool                        IsCompacting() const                { return mCompact.active;                                                   }
+
+            uint32_t                    GetNumPages() const                 { return uint32_t(mPages.size());                                           }
+            uint8_t *                   GetPageTexture(uint32_t page) const { return page < mPages.size() ? mPages[page].texture : nullptr;             }
+            uint32_t                    GetPageWidth() const                { return mPageWidth;                                                        }
+            uint32_t                    GetPageHeight(uint32_t page) const  { return page < mPages.size() ? mPages[page].packer.GetHeight() : 0;        }
+            uint32_t                    GetMaxPageHeight() const            { return mPageHeight;                                                       }
+            uint32_t                    GetNumResizes() const               { return mNumResizes;                                                       }
+
+            // Areas changed since the last call: new regions (to be filled by their clients), new, grown or cleared pages
+            // and every page after compacting. Meant for a single consumer mirroring the pages (e.g. in a GPU texture).
+            // Pages can also disappear when compacting (see GetNumPages).
+            FontVector<DirtyRegion>     ConsumeDirtyRegions();
+            bool                        HasDirtyRegions() const             { return mDirtyRegions.empty() == false;                                    }
+
+            Stats                       GetStats() const;
+            float                       GetOccupancy() const;               // liveArea / area of all pages
+
+            // Consistency checks (for tests): the regions are inside their page, do not overlap each other
+            // and are not free space for the packer. Reports the first problem found to stderr.
+            bool                        Validate() const;
+
+        protected:
+            struct Region {
+                AtlasClient *client;
+                uint64_t    key;
+                Rect        rect;
+            };
+
+            struct Page {
+                explicit            Page(FontAllocator *allocator) : packer(false, false, allocator), regions(FontVector<Region>::allocator_type(allocator))  { }
+
+                SkylineBinPack      packer;
+                uint8_t             *texture {};
+                size_t              reserved {};    // Bytes of address space
+                size_t              committed {};   // Bytes backed by memory (zero filled)
+                FontVector<Region>  regions;
+                uint64_t            liveArea {};
+            };
+
+            // Live region waiting to be moved to the new pages
+            struct Placement {
+                Region      region;
+                uint32_t    srcPage;
+            };
+
+            struct CompactState {
+                FontVector<Placement>   pending;        // Tallest first
+                size_t                  next {};
+                FontVector<Page>        pages;          // Packers at full height, textures grow on demand
+                FontVector<uint32_t>    textureHeights;
+                bool                    active {};
+                bool                    failed {};
+            };
+
+            bool                        AddPage(uint32_t height);
+            bool                        GrowPage(uint32_t page);
+            bool                        NewTexture(Page &page, uint32_t height);
+            bool                        CommitTexture(Page &page, uint32_t height);
+            void                        FreeTexture(Page &page);
+            bool                        InsertGrowing(FontVector<SkylineBinPack> &packers, uint32_t width, uint32_t height, uint32_t *pPage, Rect *pRect);
+            void                        FreePages();
+            void                        FreePages(FontVector<Page> &pages);
+
+            template <typename Predicate>
+            void                        ReleaseIf(const Predicate &isReleased);
+
+            bool                        PlaceRegion(const Placement &placement);
+            void                        FinishCompact();
+
+            void                        AddDirtyRegion(uint32_t page, const Rect &rect);
+            void                        AddDirtyPage(uint32_t page, uint32_t fromY = 0);
+
+        protected:
+            FontVector<Page>    mPages;
+            CompactState        mCompact;
+            FontVector<DirtyRegion>     mDirtyRegions;
+            FontAllocator       *mTextureAllocator {};     // nullptr: virtual memory
+            FontAllocator       *mAllocator {};            // Containers (nullptr until Init: the default one)
+            uint32_t            mPageWidth {};
+            uint32_t            mPageHeight {};
+            uint32_t            mInitialPageHeight {};
+            uint32_t            mNumResizes {};
+            ELevelChoiceHeuristic   mHeuristic { ELevelChoiceHeuristic::LevelBottomLeft };
+            bool                mAllowRotation {};
+            bool                mUseWasteMap {};
+    };
+
+} // end of namespace
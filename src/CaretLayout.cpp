@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "CaretLayout.h"
+//-------------------------------------
+#include <algorithm>
+
+using namespace MindShake;
+
+//-------------------------------------
+CaretLayout::CaretLayout(FontAllocator *allocator)
+    : mX(FontVector<int32_t>::allocator_type(allocator != nullptr ? allocator : FontAllocator::GetDefault()))
+    , mOffsets(FontVector<uint32_t>::allocator_type(allocator != nullptr ? allocator : FontAllocator::GetDefault()))
+    , mLineStarts(FontVector<uint32_t>::allocator_type(allocator != nullptr ? allocator : FontAllocator::GetDefault())) {
+}
+
+//-------------------------------------
+void
+CaretLayout::Clear() {
+    mX.clear();
+    mOffsets.clear();
+    mLineStarts.clear();
+    mLineHeight = 0;
+}
+
+//-------------------------------------
+int32_t
+CaretLayout::GetX(uint32_t index) const {
+    if(mX.empty())
+        return 0;
+
+    return mX[std::min(index, uint32_t(mX.size() - 1))];
+}
+
+//-------------------------------------
+uint32_t
+CaretLayout::GetLine(uint32_t index) const {
+    if(mLineStarts.empty())
+        return 0;
+
+    return uint32_t(std::upper_bound(mLineStarts.begin(), mLineStarts.end(), index) - mLineStarts.begin()) - 1;
+}
+
+//-------------------------------------
+uint32_t
+CaretLayout::GetByteOffset(uint32_t index) const {
+    if(mOffsets.empty())
+        return 0;
+
+    return mOffsets[std::min(index, uint32_t(mOffsets.size() - 1))];
+}
+
+//-------------------------------------
+// Last caret of the line (before its '\n' or at the end of the text)
+uint32_t
+CaretLayout::GetLineEnd(uint32_t line) const {
+    return line + 1 < mLineStarts.size() ? mLineStarts[line + 1] - 1 : uint32_t(mX.size() - 1);
+}
+
+//-------------------------------------
+uint32_t
+CaretLayout::GetIndexAt(int32_t x, int32_t y) const {
+    if(mX.empty())
+        return 0;
+
+    uint32_t line = y > 0 && mLineHeight > 0 ? std::min(uint32_t(y / mLineHeight), GetNumLines() - 1) : 0;
+    auto     begin = mX.begin() + mLineStarts[line];
+    auto     end   = mX.begin() + GetLineEnd(line) + 1;
+
+    // First caret beyond x, or the previous one if it is closer
+    auto it = std::upper_bound(begin, end, x);
+    if(it == begin)
+        return uint32_t(begin - mX.begin());
+    if(it == end || x - *(it - 1) < *it - x)
+        --it;
+
+    return uint32_t(it - mX.begin());
+}
+
+//-------------------------------------
+uint32_t
+CaretLayout::GetSelectionRects(uint32_t begin, uint32_t end, Rect *pRects, uint32_t maxRects) const {
+    if(mX.empty() || pRects == nullptr)
+        return 0;
+
+    uint32_t last = uint32_t(mX.size() - 1);
+    begin = std::min(begin, last);
+    end   = std::min(end, last);
+    if(begin > end)
+        std::swap(begin, end);
+
+    uint32_t count   = 0;
+    uint32_t endLine = GetLine(end);
+    for(uint32_t line = GetLine(begin); line <= endLine && count < maxRects; ++line) {
+        int32_t left  = mX[std::max(begin, mLineStarts[line])];
+        int32_t right = mX[std::min(end, GetLineEnd(line))];
+
+        pRects[count++] = { left, int32_t(line) * mLineHeight, right - left, mLineHeight };
+    }
+
+    return count;
+}
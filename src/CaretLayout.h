@@ -0,0 +1,58 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontAllocator.h"
+#include "SkylineBinPack.h"
+//-------------------------------------
+#include <cstdint>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Caret positions of a text as DrawText lays it out (advances and kerning), filled by Font::LayoutCarets.
+    // Caret i is before the code point i and the last one is at the end of the text, so a text of n code points
+    // has n + 1 carets. The caret before a '\n' ends its line and the next one starts the following line at x 0.
+    // Built once per text, the queries are binary searches (left to right text).
+    // Coordinates are relative to the position given to DrawText.
+    class CaretLayout {
+        friend class Font;
+
+        public:
+            using Rect = SkylineBinPack::Rect;
+
+        public:
+            explicit                    CaretLayout(FontAllocator *allocator = nullptr);
+
+            void                        Clear();
+
+            uint32_t                    GetNumCarets() const                { return uint32_t(mX.size());               }
+            uint32_t                    GetNumLines() const                 { return uint32_t(mLineStarts.size());      }
+            int32_t                     GetLineHeight() const               { return mLineHeight;                       }
+
+            // Indices beyond the end are clamped to the last caret
+            int32_t                     GetX(uint32_t index) const;
+            uint32_t                    GetLine(uint32_t index) const;
+            uint32_t                    GetByteOffset(uint32_t index) const;        // In the utf8 text
+            // Nearest caret to the point (e.g. the mouse), in the line under it (clamped to the first and last ones)
+            uint32_t                    GetIndexAt(int32_t x, int32_t y) const;
+            // Selection between two carets (in any order): one rect per line, up to maxRects. Returns the number of rects.
+            uint32_t                    GetSelectionRects(uint32_t begin, uint32_t end, Rect *pRects, uint32_t maxRects) const;
+
+        protected:
+            uint32_t                    GetLineEnd(uint32_t line) const;
+
+        protected:
+            FontVector<int32_t>     mX;                 // Per caret
+            FontVector<uint32_t>    mOffsets;           // Per caret
+            FontVector<uint32_t>    mLineStarts;        // First caret of each line
+            int32_t                 mLineHeight {};
+    };
+
+} // end of namespace
@@ -6,42 +6,313 @@
 //-----------------------------------------------------------------------------
 
 #include "Font.h"
+#include "FontTrace.h"
+#include "GlyphBlit.h"
+#include "ScratchArena.h"
 #include "UTF8_Utils.h"
 //-------------------------------------
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 using namespace MindShake;
 
 //-------------------------------------
-Font::Font(const char *fontName) {
+Font::Font(const char *fontName, FontAllocator *allocator) : Font(static_cast<FontFace *>(nullptr), allocator) {
     mFontName = fontName;
+    mFace     = FontFace::Load(fontName, mAllocator);
+}
+
+//-------------------------------------
+Font::Font(FontFace *face, FontAllocator *allocator)
+    : mAllocator(allocator != nullptr ? allocator : FontAllocator::GetDefault())
+    , mOwnAllocator(allocator != nullptr)
+    , mFontName(face != nullptr ? face->GetFontName().c_str() : "", FontString::allocator_type(mAllocator))
+    , mHeightData(MapHeightData::allocator_type(mAllocator))
+    , mCodePointData(MapCodePointData::allocator_type(mAllocator))
+    , mCodePointHeightData(MapCodePointHeightData::allocator_type(mAllocator))
+    , mGlyphMetrics(MapGlyphMetrics::allocator_type(mAllocator))
+    , mRenderConfigs(VecRenderConfig::allocator_type(mAllocator))
+    , mTextCache(mAllocator)
+    , mTextLayout { 0, FontString(FontString::allocator_type(mAllocator)), FontVector<TextCache::Glyph>(FontVector<TextCache::Glyph>::allocator_type(mAllocator)), {}, 0 } {
+    mAtlas = &mOwnAtlas;
+    mFace  = face;
+    if(mFace != nullptr)
+        mFace->AddRef();
 
     // Trash data
     mHeightData[0]          = {};
     mCodePointData[0]       = {};
     mCodePointHeightData[0] = {};
+    mGlyphMetrics[0]        = {};
+
+    // Config 0: no antialias
+    mRenderConfigs.push_back({});
+}
+
+//-------------------------------------
+Font::~Font() {
+    if(mAtlas != &mOwnAtlas) {
+        mAtlas->Release(this);
+    }
+
+    if(mFace != nullptr) {
+        mFace->Release();
+        mFace = nullptr;
+    }
 }
 
 //-------------------------------------
 void
 Font::Reset() {
-    mPacker.Reset();
+    // Our own atlas is left empty, so it is cleared
+    mAtlas->Release(this);
 
+    mTextCache.Clear();
     mCodePointHeightData.clear();
     mCodePointHeightData[0] = {};
+    mGlyphMetrics.clear();
+    mGlyphMetrics[0] = {};
+
+    // No glyph uses the other render configs now
+    mRenderConfigs.resize(1);
+    mRenderConfig = 0;
+    UpdateRenderConfig();
+}
+
+//-------------------------------------
+void
+Font::ReleaseHeight(uint8_t height) {
+    FontVector<uint64_t>    keys { FontVector<uint64_t>::allocator_type(mAllocator) };
+    CodePointHeight         cph;
+
+    for(auto it = mCodePointHeightData.begin(); it != mCodePointHeightData.end(); ) {
+        cph.value = it->first;
+        if(cph.value != 0 && cph.height == height) {
+            keys.push_back(cph.value);
+            it = mCodePointHeightData.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for(auto it = mGlyphMetrics.begin(); it != mGlyphMetrics.end(); ) {
+        cph.value = it->first;
+        it = (cph.value != 0 && cph.height == height) ? mGlyphMetrics.erase(it) : std::next(it);
+    }
 
-    memset(mTexture, 0, mPacker.GetWidth() * mPacker.GetHeight());
+    if(keys.empty() == false) {
+        mTextCache.Clear();
+        mAtlas->Release(this, std::move(keys));
+    }
+}
+
+//-------------------------------------
+void
+Font::ReleaseOtherRenderConfigs() {
+    FontVector<uint64_t>    keys { FontVector<uint64_t>::allocator_type(mAllocator) };
+    CodePointHeight         cph;
+
+    for(auto it = mCodePointHeightData.begin(); it != mCodePointHeightData.end(); ) {
+        cph.value = it->first;
+        if(cph.value != 0 && cph.config != mRenderConfig) {
+            keys.push_back(cph.value);
+            it = mCodePointHeightData.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for(auto it = mGlyphMetrics.begin(); it != mGlyphMetrics.end(); ) {
+        cph.value = it->first;
+        it = (cph.value != 0 && cph.config != mRenderConfig) ? mGlyphMetrics.erase(it) : std::next(it);
+    }
+
+    if(keys.empty() == false) {
+        mTextCache.Clear();
+        mAtlas->Release(this, std::move(keys));
+    }
+}
+
+//-------------------------------------
+void
+Font::UpdateRenderConfig() {
+    // The weights do not matter without antialias
+    RenderConfig config {};
+    if(mUseAntialias) {
+        config = { mAACenter, mAABorder, mAACorner, true, mAntialiasAllowEx };
+    }
+
+    for(size_t i=0; i<mRenderConfigs.size(); ++i) {
+        if(mRenderConfigs[i] == config) {
+            mRenderConfig = uint8_t(i);
+            return;
+        }
+    }
+
+    // No ids left: start over (Reset adds the current config)
+    if(mRenderConfigs.size() > 0xff) {
+        Reset();
+        return;
+    }
+
+    mRenderConfigs.push_back(config);
+    mRenderConfig = uint8_t(mRenderConfigs.size() - 1);
+}
+
+//-------------------------------------
+// Sets the members without changing the current config (Validate rasterizes the cached glyphs again)
+void
+Font::ApplyRenderConfig(const RenderConfig &config) {
+    mUseAntialias     = config.useAntialias;
+    mAntialiasAllowEx = config.allowEx;
+    mAACenter         = config.center;
+    mAABorder         = config.border;
+    mAACorner         = config.corner;
+}
+
+//-------------------------------------
+bool
+Font::RepackAtlas(float timeBudgetMs) {
+    if(mAtlas->IsCompacting() == false) {
+        mAtlas->BeginCompact();
+    }
+
+    return mAtlas->StepCompact(timeBudgetMs);
 }
 
 //-------------------------------------
 bool
-Font::InitPacker() {
-    mPacker.Init(512, 128, false);
-    mTexture = (uint8_t *) calloc(mPacker.GetWidth() * mPacker.GetHeight(), 1);
-    if (mTexture == nullptr) {
-        fprintf(stderr, "Not enough memory\n");
+Font::Validate() {
+    CodePointHeight cph;
+
+    if(mStatus < 0 || mAtlas->Validate() == false)
+        return false;
+
+    const CodePointHeightData &trash = mCodePointHeightData[0];
+    if(trash.glyph != 0) {
+        fprintf(stderr, "%s: the trash glyph data was modified\n", mFontName.c_str());
+        return false;
+    }
+
+    // Each glyph is compared with the settings it was rendered with
+    RenderConfig current { mAACenter, mAABorder, mAACorner, mUseAntialias, mAntialiasAllowEx };
+    bool         valid = true;
+
+    for(const auto &entry : mCodePointHeightData) {
+        cph.value = entry.first;
+        if(cph.value == 0)
+            continue;
+
+        const char *problem = nullptr;
+        const CodePointHeightData &data = entry.second;
+        const uint8_t *texture = mAtlas->GetPageTexture(data.page);
+        GlyphBox box;
+        if(cph.config >= mRenderConfigs.size()) {
+            problem = "has an unknown render config";
+        }
+        else if(texture == nullptr || data.glyph <= 0 || data.rect.right() > int32_t(mAtlas->GetPageWidth()) || data.rect.bottom() > int32_t(mAtlas->GetPageHeight(data.page))) {
+            problem = "has an invalid atlas region";
+        }
+        else {
+            ApplyRenderConfig(mRenderConfigs[cph.config]);
+            if(MeasureGlyph(cph.codePoint, cph.height, &box, ETextEffect(cph.effect), uint8_t(cph.radius)) == false || box.width != data.GetWidth() || box.height != data.GetHeight()) {
+                problem = "has a different size";
+            }
+        }
+
+        // The text measured without the atlas must match the drawn one
+        auto metrics = mGlyphMetrics.find(cph.value);
+        if(problem == nullptr && metrics != mGlyphMetrics.end()) {
+            const GlyphMetrics &m = metrics->second;
+            if(m.glyph != data.glyph || m.advanceWidth != data.advanceWidth || m.x != data.x || m.y != data.y || m.width != data.GetWidth() || m.height != data.GetHeight()) {
+                problem = "has different metrics";
+            }
+        }
+
+        ScratchScope scratch;
+        const uint8_t *pixels = nullptr;
+        if(problem == nullptr && (pixels = RasterizeGlyph(box, cph.height)) == nullptr) {
+            problem = "can not be rasterized";
+        }
+
+        size_t stride = mAtlas->GetPageWidth();
+        for(int32_t y = 0; y < box.height && problem == nullptr; ++y) {
+            for(int32_t x = 0; x < box.width; ++x) {
+                size_t offset = data.rotated ? (data.rect.y + x) * stride + data.rect.x + y : (data.rect.y + y) * stride + data.rect.x + x;
+                if(texture[offset] != pixels[y * box.width + x]) {
+                    problem = "differs from the rasterizer";
+                    break;
+                }
+            }
+        }
+
+        if(problem != nullptr) {
+            fprintf(stderr, "%s: code point %u height %u config %u %s\n", mFontName.c_str(), uint32_t(cph.codePoint), uint32_t(cph.height), uint32_t(cph.config), problem);
+            valid = false;
+            break;
+        }
+    }
+
+    ApplyRenderConfig(current);
+
+    return valid;
+}
+
+//-------------------------------------
+void
+Font::SetAtlas(AtlasManager *atlas) {
+    if(atlas == nullptr)
+        atlas = &mOwnAtlas;
+
+    if(atlas == mAtlas)
+        return;
+
+    // Created with a shared atlas, ours is initialized the first time it is needed
+    if(atlas == &mOwnAtlas && mOwnAtlas.GetNumPages() == 0 && InitPacker() == false)
+        return;
+
+    Reset();
+    mAtlas = atlas;
+}
+
+//-------------------------------------
+bool
+Font::InitFace() {
+    if(mFace == nullptr) {
+        mStatus = -3;
+        return false;
+    }
+    if(mFace->GetStatus() != 1) {
+        mStatus = mFace->GetStatus();
+        return false;
+    }
+
+    mAscent  = mFace->GetAscent();
+    mDescent = mFace->GetDescent();
+    mLineGap = mFace->GetLineGap();
+
+    return true;
+}
+
+//-------------------------------------
+bool
+Font::InitPacker(AtlasManager *atlas) {
+    if(atlas != nullptr) {
+        mAtlas = atlas;
+        return true;
+    }
+
+    // One page 512 pixels wide, growing by doubling its height (up to 16 MB).
+    // With an allocator of the user, pages of 512 x 512 allocated at once.
+    bool ok = mOwnAllocator ? mOwnAtlas.Init(512, 512, 512, mAllocator) : mOwnAtlas.Init(512, 0x8000, 128);
+    if(ok == false) {
         mStatus = -5;
         return false;
     }
@@ -49,6 +320,401 @@ Font::InitPacker() {
     return true;
 }
 
+//-------------------------------------
+bool
+Font::AddGlyphToAtlas(uint64_t key, const uint8_t *pixels, int32_t width, int32_t height, CodePointHeightData *pData) {
+    StatsTimer timer;
+    uint32_t   resizes = mAtlas->GetNumResizes();
+
+    if(mAtlas->Allocate(this, key, width, height, &pData->page, &pData->rect, &pData->rotated) == false)
+        return false;
+
+    if(mAtlas->GetNumResizes() != resizes) {
+        AddEvent(EFontEvent::AtlasResize, timer, pData->glyph, CodePointHeight { key }.height);
+    }
+
+    CopyGlyphToAtlas(pixels, width, height, *pData);
+
+    return true;
+}
+
+//-------------------------------------
+void
+Font::CopyGlyphToAtlas(const uint8_t *pixels, int32_t width, int32_t height, const CodePointHeightData &data) {
+    FONT_TRACE_SCOPE("CopyGlyphToAtlas");
+
+    uint8_t *texture    = mAtlas->GetPageTexture(data.page);
+    size_t  stride      = mAtlas->GetPageWidth();
+    size_t  byteOffset  = data.rect.y * stride + data.rect.x;
+    size_t  pixelsOffset = 0;
+    if(data.rotated) {
+        // Glyph rows go to atlas columns
+        for(int y=0; y<height; ++y) {
+            for(int x=0; x<width; ++x) {
+                texture[byteOffset + x * stride] = pixels[pixelsOffset + x];
+            }
+            byteOffset   += 1;
+            pixelsOffset += width;
+        }
+        return;
+    }
+
+    for(int y=0; y<height; ++y) {
+        memcpy(&texture[byteOffset], &pixels[pixelsOffset], width);
+        byteOffset   += stride;
+        pixelsOffset += width;
+    }
+}
+
+//-------------------------------------
+const CodePointHeightData &
+Font::GetCodePointDataForHeight(uint32_t index, uint8_t height, ETextEffect effect, uint8_t radius) {
+    if(mStatus < 0)
+        return mCodePointHeightData[0];
+
+    CodePointHeight cph {};
+    cph.codePoint = index;
+    cph.height    = height;
+    cph.config    = mRenderConfig;
+    cph.effect    = uint8_t(effect);
+    cph.radius    = radius;
+
+    auto cphd = mCodePointHeightData.find(cph.value);
+    CountGlyphLookup(cphd != mCodePointHeightData.end());
+    if(cphd == mCodePointHeightData.end()) {
+        FONT_TRACE_SCOPE("GlyphMiss", "codePoint", index, "height", height);
+
+        GlyphBox box;
+        if(MeasureGlyph(index, height, &box, effect, radius) == false)
+            return mCodePointHeightData[0];
+
+        ScratchScope scratch;
+        uint8_t *pixels = RasterizeGlyph(box, height);
+        if(pixels == nullptr)
+            return mCodePointHeightData[0];
+
+        if(AddGlyphToAtlas(cph.value, pixels, box.width, box.height, &box.data) == false)
+            return mCodePointHeightData[0];
+
+        cphd = mCodePointHeightData.insert({cph.value, box.data}).first;
+    }
+
+    return cphd->second;
+}
+
+//-------------------------------------
+// Same box and advance as the glyph in the atlas, without rasterizing it (and cached for the code points without glyph too)
+const GlyphMetrics &
+Font::GetGlyphMetrics(uint32_t index, uint8_t height) {
+    if(mStatus < 0)
+        return mGlyphMetrics[0];
+
+    CodePointHeight cph {};
+    cph.codePoint = index;
+    cph.height    = height;
+    cph.config    = mRenderConfig;
+
+    auto it = mGlyphMetrics.find(cph.value);
+    if(it == mGlyphMetrics.end()) {
+        GlyphBox     box;
+        GlyphMetrics metrics {};
+        if(MeasureGlyph(index, height, &box)) {
+            metrics = { box.data.glyph, box.data.advanceWidth, box.data.x, box.data.y, box.width, box.height };
+        }
+
+        it = mGlyphMetrics.insert({cph.value, metrics}).first;
+    }
+
+    return it->second;
+}
+
+//-------------------------------------
+bool
+Font::MeasureGlyph(uint32_t index, uint8_t height, GlyphBox *pBox, ETextEffect effect, uint8_t radius) {
+    const CodePointData &codePoint = GetCodePointData(index);
+    if(codePoint.glyph == 0)
+        return false;
+
+    pBox->data       = {};
+    pBox->data.glyph = codePoint.glyph;
+    if(GetGlyphBox(codePoint, height, &pBox->data, &pBox->rawWidth, &pBox->rawHeight) == false)
+        return false;
+
+    // special case (' ')
+    pBox->isEmpty = (pBox->rawWidth <= 0 || pBox->rawHeight <= 0);
+    pBox->width   = std::max(pBox->rawWidth,  1);
+    pBox->height  = std::max(pBox->rawHeight, 1);
+    if(pBox->isEmpty == false && mUseAntialias && mAntialiasAllowEx) {
+        pBox->width  += 2;
+        pBox->height += 2;
+    }
+
+    // The effect spreads the coverage around the glyph
+    pBox->effect  = effect;
+    pBox->radius  = radius;
+    pBox->padding = 0;
+    if(pBox->isEmpty == false && effect != ETextEffect::None) {
+        pBox->padding = effect == ETextEffect::Glow ? radius * 2 : radius;
+        pBox->width  += pBox->padding * 2;
+        pBox->height += pBox->padding * 2;
+        pBox->data.x -= pBox->padding;
+        pBox->data.y -= pBox->padding;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+// The pixels are scratch memory of the thread (the caller holds the ScratchScope)
+uint8_t *
+Font::RasterizeGlyph(const GlyphBox &box, uint8_t height) {
+    if(box.padding != 0)
+        return RasterizeEffect(box, height);
+
+    ScratchArena &scratch = ScratchArena::GetThreadArena();
+
+    auto pixels = static_cast<uint8_t *>(scratch.Allocate(box.width * box.height));
+    if(pixels == nullptr)
+        return nullptr;
+
+    memset(pixels, 0, box.width * box.height);
+    if(box.isEmpty)
+        return pixels;
+
+    if(mUseAntialias == false) {
+        StatsTimer timer;
+        if(RenderGlyph(box.data.glyph, height, pixels, box.width, box.height) == false)
+            return nullptr;
+        AddEvent(EFontEvent::Rasterize, timer, box.data.glyph, height);
+
+        return pixels;
+    }
+
+    auto src = static_cast<uint8_t *>(scratch.Allocate(box.rawWidth * box.rawHeight));
+    if(src == nullptr)
+        return nullptr;
+
+    memset(src, 0, box.rawWidth * box.rawHeight);
+    StatsTimer rasterizeTimer;
+    if(RenderGlyph(box.data.glyph, height, src, box.rawWidth, box.rawHeight) == false)
+        return nullptr;
+    AddEvent(EFontEvent::Rasterize, rasterizeTimer, box.data.glyph, height);
+
+    StatsTimer antialiasTimer;
+    if(mAntialiasAllowEx)
+        AABlockEx(src, box.rawWidth, box.rawHeight, pixels, box.width);
+    else
+        AABlock(src, box.rawWidth, box.rawHeight, pixels, box.width);
+    AddEvent(EFontEvent::Antialias, antialiasTimer, box.data.glyph, height);
+
+    return pixels;
+}
+
+//-------------------------------------
+// Max of the coverage around each pixel, weighted by a disk of radius + 0.5 (smooth edges). dst has room for the radius.
+static void
+DilateCoverage(const uint8_t *src, int32_t width, int32_t height, int32_t radius, uint16_t *weights, uint8_t *dst, int32_t dstStride) {
+    int32_t size = radius * 2 + 1;
+    for(int32_t y=0; y<size; ++y) {
+        for(int32_t x=0; x<size; ++x) {
+            float distance = std::sqrt(float((x - radius) * (x - radius) + (y - radius) * (y - radius)));
+            weights[y * size + x] = uint16_t(std::min(std::max(float(radius) + 1.0f - distance, 0.0f), 1.0f) * 256.0f);
+        }
+    }
+
+    for(int32_t y=0; y<height; ++y) {
+        for(int32_t x=0; x<width; ++x) {
+            uint32_t coverage = src[y * width + x];
+            if(coverage == 0)
+                continue;
+
+            uint8_t        *line   = dst + (y - radius) * dstStride + (x - radius);
+            const uint16_t *weight = weights;
+            for(int32_t j=0; j<size; ++j, line += dstStride, weight += size) {
+                for(int32_t i=0; i<size; ++i) {
+                    line[i] = std::max(line[i], uint8_t((coverage * weight[i]) >> 8));
+                }
+            }
+        }
+    }
+}
+
+//-------------------------------------
+// Box filter along a row or a column (step), in place
+static void
+BoxBlurLine(uint8_t *line, int32_t count, int32_t step, int32_t radius, uint8_t *temp) {
+    int32_t size = radius * 2 + 1;
+    int32_t sum  = 0;
+
+    for(int32_t i=0; i<count; ++i) {
+        temp[i] = line[i * step];
+    }
+    for(int32_t i=0; i<radius && i<count; ++i) {
+        sum += temp[i];
+    }
+
+    for(int32_t i=0; i<count; ++i) {
+        if(i + radius < count)
+            sum += temp[i + radius];
+        if(i - radius - 1 >= 0)
+            sum -= temp[i - radius - 1];
+        line[i * step] = uint8_t((sum + size / 2) / size);
+    }
+}
+
+//-------------------------------------
+// Two box filters per axis (close to a gaussian) reaching radius pixels
+static void
+BlurCoverage(uint8_t *pixels, int32_t width, int32_t height, int32_t radius, uint8_t *temp) {
+    const int32_t radii[] = { (radius + 1) / 2, radius / 2 };
+
+    for(int32_t boxRadius : radii) {
+        if(boxRadius == 0)
+            continue;
+
+        for(int32_t y=0; y<height; ++y) {
+            BoxBlurLine(pixels + y * width, width, 1, boxRadius, temp);
+        }
+        for(int32_t x=0; x<width; ++x) {
+            BoxBlurLine(pixels + x, height, width, boxRadius, temp);
+        }
+    }
+}
+
+//-------------------------------------
+// The glyph rasterized as usual in the middle of the padding, then spread over it.
+// The pixels are scratch memory of the thread (the caller holds the ScratchScope).
+uint8_t *
+Font::RasterizeEffect(const GlyphBox &box, uint8_t height) {
+    ScratchArena &scratch = ScratchArena::GetThreadArena();
+
+    GlyphBox glyphBox = box;
+    glyphBox.width  -= box.padding * 2;
+    glyphBox.height -= box.padding * 2;
+    glyphBox.padding = 0;
+
+    const uint8_t *glyph = RasterizeGlyph(glyphBox, height);
+    if(glyph == nullptr)
+        return nullptr;
+
+    int32_t size    = box.radius * 2 + 1;
+    auto    pixels  = static_cast<uint8_t *>(scratch.Allocate(box.width * box.height));
+    auto    temp    = static_cast<uint8_t *>(scratch.Allocate(std::max(box.width, box.height)));
+    auto    weights = static_cast<uint16_t *>(scratch.Allocate(size * size * sizeof(uint16_t)));
+    if(pixels == nullptr || temp == nullptr || weights == nullptr)
+        return nullptr;
+
+    FONT_TRACE_SCOPE("RasterizeEffect");
+
+    memset(pixels, 0, box.width * box.height);
+    uint8_t *center = pixels + box.padding * box.width + box.padding;
+    if(box.effect == ETextEffect::Shadow) {
+        for(int32_t y=0; y<glyphBox.height; ++y) {
+            memcpy(center + y * box.width, glyph + y * glyphBox.width, glyphBox.width);
+        }
+    }
+    else {
+        DilateCoverage(glyph, glyphBox.width, glyphBox.height, box.radius, weights, center, box.width);
+    }
+
+    if(box.effect != ETextEffect::Outline) {
+        BlurCoverage(pixels, box.width, box.height, box.radius, temp);
+    }
+
+    return pixels;
+}
+
+//-------------------------------------
+uint32_t
+Font::PreloadGlyphs(const char *utf8, const uint8_t *heights, uint32_t numHeights) {
+    FontVector<GlyphBox>                    boxes { FontVector<GlyphBox>::allocator_type(mAllocator) };
+    FontVector<AtlasManager::BatchRegion>   regions { FontVector<AtlasManager::BatchRegion>::allocator_type(mAllocator) };
+    FontVector<uint64_t>                    failed { FontVector<uint64_t>::allocator_type(mAllocator) };
+    FontHashSet<uint64_t>                   pending { FontHashSet<uint64_t>::allocator_type(mAllocator) };
+    uint32_t                                codePoint;
+    uint32_t                                added = 0;
+    CodePointHeight                         cph {};
+
+    if(utf8 == nullptr || heights == nullptr || mStatus < 0)
+        return 0;
+
+    cph.config = mRenderConfig;
+
+    FONT_TRACE_SCOPE("PreloadGlyphs");
+
+    {
+        FONT_TRACE_SCOPE("DecodeAndMeasure");
+
+        while((codePoint = GetNextUTF32(&utf8)) != 0) {
+            for(uint32_t i=0; i<numHeights; ++i) {
+                cph.codePoint = codePoint;
+                cph.height    = heights[i];
+                if(cph.height == 0 || mCodePointHeightData.find(cph.value) != mCodePointHeightData.end())
+                    continue;
+
+                // Repeated code points
+                if(pending.insert(cph.value).second == false)
+                    continue;
+
+                GlyphBox box;
+                if(MeasureGlyph(codePoint, cph.height, &box) == false)
+                    continue;
+
+                AtlasManager::BatchRegion region {};
+                region.key    = cph.value;
+                region.width  = uint32_t(box.width);
+                region.height = uint32_t(box.height);
+                regions.push_back(region);
+                boxes.push_back(box);
+            }
+        }
+    }
+
+    if(regions.empty())
+        return 0;
+
+    mAtlas->AllocateBatch(this, regions);
+
+    for(size_t i=0; i<regions.size(); ++i) {
+        const auto &region = regions[i];
+        if(region.allocated == false)
+            continue;
+
+        GlyphBox &box = boxes[i];
+        box.data.page    = region.page;
+        box.data.rect    = region.rect;
+        box.data.rotated = region.rotated;
+
+        cph.value = region.key;
+        ScratchScope scratch;
+        uint8_t *pixels = RasterizeGlyph(box, cph.height);
+        if(pixels == nullptr) {
+            failed.push_back(region.key);
+            continue;
+        }
+
+        CopyGlyphToAtlas(pixels, box.width, box.height, box.data);
+        mCodePointHeightData.insert({ cph.value, box.data });
+        ++added;
+    }
+
+    if(failed.empty() == false) {
+        mAtlas->Release(this, std::move(failed));
+    }
+
+    return added;
+}
+
+//-------------------------------------
+void
+Font::OnAtlasRegionMoved(uint64_t key, uint32_t page, const Rect &rect) {
+    auto cphd = mCodePointHeightData.find(key);
+    if(cphd != mCodePointHeightData.end()) {
+        cphd->second.page = page;
+        cphd->second.rect = rect;
+    }
+}
+
 //-------------------------------------
 void
 Font::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) {
@@ -56,10 +722,7 @@ Font::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *d
         return;
 
     uint32_t codePoint;
-    uint32_t offsetDst, offsetTexture;
     uint32_t offsetTextX, offsetTextY;
-    int32_t  currentX, currentY;
-    int32_t  minX, maxX, minY, maxY;
 
     Color32 fontColor = *reinterpret_cast<Color32 *>(&color);
 
@@ -67,9 +730,21 @@ Font::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *d
 
     posY += heightData.ascent; // baseline
 
+    FONT_TRACE_SCOPE("DrawText");
+    CountDrawCall();
+
+    if(mTextCache.IsEnabled() && mStatus >= 0) {
+        const TextCache::Text &text = GetTextLayout(utf8, textHeight);
+        for(const auto &glyph : text.glyphs) {
+            const CodePointHeightData &data = *glyph.data;
+            CountBlit(BlitGlyph(mAtlas->GetPageTexture(data.page), mAtlas->GetPageWidth(), data.rect, data.rotated, posX + glyph.x, posY + glyph.y, fontColor, dst, dstStride, mLeft, mTop, mRight, mBottom));
+        }
+        return;
+    }
+
     offsetTextX = 0;
     offsetTextY = 0;
-    while((codePoint = GetNextUTF32(reinterpret_cast<const uint8_t **>(&utf8))) != 0) {
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
         if(codePoint == '\n') {
             offsetTextX = 0;
             offsetTextY += (heightData.ascent - heightData.descent);
@@ -78,59 +753,7 @@ Font::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *d
 
         const CodePointHeightData &data = GetCodePointDataForHeight(codePoint, textHeight);
         if(data.glyph > 0) {
-            // Clip Top
-            currentY = posY + data.y + offsetTextY;
-            minY = data.rect.top();
-            if(currentY < mTop) {
-                minY    += mTop - currentY;
-                currentY = mTop;
-            }
-
-            // Clip Bottom (if the beginning is beyond the bottom limit)
-            if(currentY < mBottom) {
-                // Clip Left
-                currentX = posX + data.x + offsetTextX;
-                minX = data.rect.left();
-                if(currentX < mLeft) {
-                    minX    += mLeft - currentX;
-                    currentX = mLeft;
-                }
-
-                // Clip Right (if the beginning is beyond the right limit)
-                if(currentX < mRight) {
-                    // Clip Right
-                    maxX = data.rect.right();
-                    if(currentX + maxX - minX >= mRight) {
-                        maxX = minX + mRight - currentX;
-                    }
-
-                    // Clip Bottom
-                    maxY = data.rect.bottom();
-                    if(currentY + maxY - minY >= mBottom) {
-                        maxY = minY + mBottom - currentY;
-                    }
-
-                    // Let's draw
-                    offsetTexture = minY * mPacker.GetWidth();
-                    offsetDst     = currentY * dstStride + currentX;
-                    for(int texY=minY; texY<maxY; ++texY) {
-                        for(int texX=minX, dstX=0; texX<maxX; ++texX, ++dstX) {
-                            if(mTexture[offsetTexture + texX] != 0) {
-                                uint32_t grey    = uint32_t((mTexture[offsetTexture + texX] * fontColor.a) / 255);
-                                uint32_t invGrey = 255 - grey;
-
-                                Color32  &dstColor = *reinterpret_cast<Color32 *>(&dst[offsetDst + dstX]);
-                                dstColor.b = ((fontColor.b * grey) + (dstColor.b * invGrey)) / 255;
-                                dstColor.g = ((fontColor.g * grey) + (dstColor.g * invGrey)) / 255;
-                                dstColor.r = ((fontColor.r * grey) + (dstColor.r * invGrey)) / 255;
-                                dstColor.a = 255;
-                            }
-                        }
-                        offsetTexture += mPacker.GetWidth();
-                        offsetDst     += dstStride;
-                    }
-                }
-            }
+            CountBlit(BlitGlyph(mAtlas->GetPageTexture(data.page), mAtlas->GetPageWidth(), data.rect, data.rotated, posX + data.x + offsetTextX, posY + data.y + offsetTextY, fontColor, dst, dstStride, mLeft, mTop, mRight, mBottom));
             offsetTextX += data.advanceWidth + uint32_t(GetKerning(data.glyph, GetCodePointGlyph(*utf8)) * heightData.scale);
         }
     }
@@ -138,51 +761,256 @@ Font::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *d
 
 //-------------------------------------
 void
-Font::GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect) {
+Font::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, const TextEffect &effect, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) {
     if(utf8 == nullptr || textHeight == 0)
         return;
 
+    if(effect.type == ETextEffect::None) {
+        DrawText(utf8, textHeight, color, dst, dstStride, posX, posY);
+        return;
+    }
+
     uint32_t codePoint;
-    int32_t  offsetTextX, offsetTextY;
-    int32_t  currentX, currentY;
-    int32_t  right, bottom;
-    int32_t  minX, maxX;
-    int32_t  minY, maxY;
+    uint32_t offsetTextX, offsetTextY;
+
+    Color32 fontColor   = *reinterpret_cast<Color32 *>(&color);
+    Color32 effectColor = *reinterpret_cast<const Color32 *>(&effect.color);
+
+    // Radius 0: the glyph itself is the effect
+    uint8_t     radius = std::min(effect.radius, uint8_t(63));
+    ETextEffect type   = radius != 0 ? effect.type : ETextEffect::None;
 
     const HeightData &heightData = GetDataForHeight(textHeight);
 
-    minX = minY = 0xffff;
-    maxX = maxY = 0;
+    posY += heightData.ascent; // baseline
+
+    FONT_TRACE_SCOPE("DrawTextEffect");
+    CountDrawCall();
+
+    // The effects are drawn while laying out the text and the glyphs over them afterwards
+    mTextLayout.glyphs.clear();
     offsetTextX = 0;
     offsetTextY = 0;
-    while((codePoint = GetNextUTF32(reinterpret_cast<const uint8_t **>(&utf8))) != 0) {
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
         if(codePoint == '\n') {
             offsetTextX = 0;
             offsetTextY += (heightData.ascent - heightData.descent);
-            maxY = 0;
             continue;
         }
 
         const CodePointHeightData &data = GetCodePointDataForHeight(codePoint, textHeight);
         if(data.glyph > 0) {
-            currentY = heightData.ascent + data.y + offsetTextY;
-            bottom = data.rect.height;
-            if(maxY < currentY + bottom)
-                maxY = currentY + bottom;
-            if(minY > currentY)
-                minY = currentY;
-
-            currentX = data.x + offsetTextX;
-            right = std::max(data.rect.width, data.advanceWidth);
-            if(maxX < currentX + right)
-                maxX = currentX + right;
-            if(minX > currentX)
-                minX = currentX;
+            const CodePointHeightData &layer = GetCodePointDataForHeight(codePoint, textHeight, type, radius);
+            if(layer.glyph > 0) {
+                CountBlit(BlitGlyph(mAtlas->GetPageTexture(layer.page), mAtlas->GetPageWidth(), layer.rect, layer.rotated, posX + layer.x + offsetTextX + effect.offsetX, posY + layer.y + offsetTextY + effect.offsetY, effectColor, dst, dstStride, mLeft, mTop, mRight, mBottom));
+            }
 
+            mTextLayout.glyphs.push_back({ &data, int32_t(data.x + offsetTextX), int32_t(data.y + offsetTextY) });
             offsetTextX += data.advanceWidth + uint32_t(GetKerning(data.glyph, GetCodePointGlyph(*utf8)) * heightData.scale);
         }
     }
 
+    for(const auto &glyph : mTextLayout.glyphs) {
+        const CodePointHeightData &data = *glyph.data;
+        CountBlit(BlitGlyph(mAtlas->GetPageTexture(data.page), mAtlas->GetPageWidth(), data.rect, data.rotated, posX + glyph.x, posY + glyph.y, fontColor, dst, dstStride, mLeft, mTop, mRight, mBottom));
+    }
+}
+
+//-------------------------------------
+// Same result as BlendPixel over an opaque background, two channels at a time (x / 255 == (x + 1 + (x >> 8)) >> 8 up to 255 * 255)
+static inline uint32_t
+BlendColors(uint8_t alpha, uint32_t fg, uint32_t bg) {
+    uint32_t grey    = (alpha * (fg >> 24)) / 255;
+    uint32_t invGrey = 255 - grey;
+
+    uint32_t rb = (fg & 0x00ff00ff) * grey + (bg & 0x00ff00ff) * invGrey;
+    uint32_t g  = ((fg >> 8) & 0xff) * grey + ((bg >> 8) & 0xff) * invGrey;
+    rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+    g  = ((g + 1 + (g >> 8)) >> 8) & 0xff;
+
+    return 0xff000000 | rb | (g << 8);
+}
+
+//-------------------------------------
+// Writes every pixel of the (clipped) cell once: background, or the glyph blended with it without reading dst.
+// Returns the pixels of the glyph (the rest is background).
+static uint32_t
+FillCell(const uint8_t *texture, uint32_t textureStride, const CodePointHeightData *data, int32_t glyphX, int32_t glyphY, uint32_t fg, uint32_t bg, uint32_t *dst, uint32_t dstStride, int32_t clipLeft, int32_t clipTop, int32_t clipRight, int32_t clipBottom) {
+    int32_t glyphRight  = data != nullptr ? glyphX + data->GetWidth()  : glyphX;
+    int32_t glyphBottom = data != nullptr ? glyphY + data->GetHeight() : glyphY;
+    int32_t left        = std::min(std::max(glyphX, clipLeft), clipRight);
+    int32_t right       = std::max(std::min(glyphRight, clipRight), left);
+
+    uint32_t *line       = dst + size_t(clipTop) * dstStride;
+    uint32_t glyphPixels = 0;
+    for(int32_t y=clipTop; y<clipBottom; ++y, line += dstStride) {
+        if(y < glyphY || y >= glyphBottom || left == right) {
+            std::fill(line + clipLeft, line + clipRight, bg);
+            continue;
+        }
+
+        std::fill(line + clipLeft, line + left, bg);
+        // A rotated glyph is stored transposed
+        size_t offset = data->rotated ? size_t(data->rect.y + left - glyphX) * textureStride + data->rect.x + (y - glyphY) : size_t(data->rect.y + y - glyphY) * textureStride + data->rect.x + (left - glyphX);
+        size_t step   = data->rotated ? textureStride : 1;
+        // Without branches (alpha 0 gives bg), so it vectorizes
+        if(step == 1) {
+            const uint8_t *alpha = texture + offset - left;
+            for(int32_t x=left; x<right; ++x) {
+                line[x] = BlendColors(alpha[x], fg, bg);
+            }
+        }
+        else {
+            for(int32_t x=left; x<right; ++x, offset += step) {
+                line[x] = BlendColors(texture[offset], fg, bg);
+            }
+        }
+        std::fill(line + right, line + clipRight, bg);
+        glyphPixels += uint32_t(right - left);
+    }
+
+    return glyphPixels;
+}
+
+//-------------------------------------
+uint32_t
+Font::DrawCells(const Cell *cells, uint32_t columns, uint32_t rows, uint8_t textHeight, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY, const Cell *previous) {
+    if(cells == nullptr || textHeight == 0 || mStatus < 0)
+        return 0;
+
+    uint32_t cellWidth, cellHeight;
+    uint32_t drawn = 0;
+
+    GetCellSize(textHeight, &cellWidth, &cellHeight);
+    const HeightData &heightData = GetDataForHeight(textHeight);
+
+    // Looked up once per call (the glyph data does not move while it is cached)
+    const CodePointHeightData *ascii[128] = {};
+
+    FONT_TRACE_SCOPE("DrawCells", "cells", int64_t(columns) * rows);
+    CountDrawCall();
+    for(uint32_t row=0; row<rows; ++row) {
+        int32_t top        = posY + int32_t(row * cellHeight);
+        int32_t clipTop    = std::max(top, mTop);
+        int32_t clipBottom = std::min(top + int32_t(cellHeight), mBottom);
+        if(clipTop >= clipBottom)
+            continue;
+
+        for(uint32_t column=0; column<columns; ++column) {
+            size_t     index = size_t(row) * columns + column;
+            const Cell &cell = cells[index];
+            if(previous != nullptr && previous[index] == cell)
+                continue;
+
+            int32_t left      = posX + int32_t(column * cellWidth);
+            int32_t clipLeft  = std::max(left, mLeft);
+            int32_t clipRight = std::min(left + int32_t(cellWidth), mRight);
+            if(clipLeft >= clipRight)
+                continue;
+
+            ++drawn;
+
+            const CodePointHeightData *data = nullptr;
+            if(cell.codePoint > ' ') {
+                if(cell.codePoint < 128) {
+                    data = ascii[cell.codePoint];
+                    if(data == nullptr) {
+                        data = ascii[cell.codePoint] = &GetCodePointDataForHeight(cell.codePoint, textHeight);
+                    }
+                }
+                else {
+                    data = &GetCodePointDataForHeight(cell.codePoint, textHeight);
+                }
+
+                if(data->glyph <= 0)
+                    data = nullptr;
+            }
+
+            uint32_t cellPixels = uint32_t((clipRight - clipLeft) * (clipBottom - clipTop));
+            if(data == nullptr) {
+                if((cell.bg >> 24) != 0) {
+                    FillCell(nullptr, 0, nullptr, 0, 0, cell.fg, cell.bg, dst, dstStride, clipLeft, clipTop, clipRight, clipBottom);
+                    CountFill(cellPixels);
+                }
+                continue;
+            }
+
+            int32_t glyphX = left + data->x;
+            int32_t glyphY = top + heightData.ascent + data->y;
+            if((cell.bg >> 24) != 0) {
+                uint32_t glyphPixels = FillCell(mAtlas->GetPageTexture(data->page), mAtlas->GetPageWidth(), data, glyphX, glyphY, cell.fg, cell.bg, dst, dstStride, clipLeft, clipTop, clipRight, clipBottom);
+                CountBlit(glyphPixels);
+                CountFill(cellPixels - glyphPixels);
+            }
+            else {
+                const Color32 &fontColor = *reinterpret_cast<const Color32 *>(&cell.fg);
+                CountBlit(BlitGlyph(mAtlas->GetPageTexture(data->page), mAtlas->GetPageWidth(), data->rect, data->rotated, glyphX, glyphY, fontColor, dst, dstStride, clipLeft, clipTop, clipRight, clipBottom));
+            }
+        }
+    }
+
+    return drawn;
+}
+
+//-------------------------------------
+void
+Font::GetCellSize(uint8_t textHeight, uint32_t *pWidth, uint32_t *pHeight) {
+    const HeightData          &heightData = GetDataForHeight(textHeight);
+    const CodePointHeightData &data       = GetCodePointDataForHeight('M', textHeight);
+
+    if(pWidth != nullptr) {
+        *pWidth = data.glyph > 0 ? uint32_t(std::max(data.advanceWidth, 1)) : std::max(textHeight / 2u, 1u);
+    }
+    if(pHeight != nullptr) {
+        *pHeight = uint32_t(std::max(heightData.ascent - heightData.descent, 1));
+    }
+}
+
+//-------------------------------------
+// Returns the number of destination pixels covered by the glyph after clipping
+uint32_t
+Font::BlitGlyph(const uint8_t *texture, uint32_t textureStride, const Rect &rect, bool rotated, int32_t currentX, int32_t currentY, const Color32 &fontColor, uint32_t *dst, uint32_t dstStride, int32_t clipLeft, int32_t clipTop, int32_t clipRight, int32_t clipBottom) {
+    // Glyph coordinates (a rotated glyph is stored transposed)
+    int32_t width  = rotated ? rect.height : rect.width;
+    int32_t height = rotated ? rect.width  : rect.height;
+
+    return BlitAlpha(texture, textureStride, rect.x, rect.y, width, height, rotated, currentX, currentY, fontColor.color, dst, dstStride, clipLeft, clipTop, clipRight, clipBottom);
+}
+
+//-------------------------------------
+// Box of the text as GetTextBox gives it. getGlyph(codePoint, next byte, &advance) returns the metrics of the glyph
+// and its advance with the kerning.
+template <typename GetGlyph>
+static void
+MeasureTextBox(const char *utf8, const HeightData &heightData, GetGlyph getGlyph, SkylineBinPack::Rect *pRect) {
+    uint32_t codePoint;
+    int32_t  offsetTextX = 0, offsetTextY = 0;
+    int32_t  minX = 0xffff, maxX = 0;
+    int32_t  minY = 0xffff, maxY = 0;
+    int32_t  advance;
+
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            offsetTextY += (heightData.ascent - heightData.descent);
+            maxY = 0;
+            continue;
+        }
+
+        const GlyphMetrics &metrics = getGlyph(codePoint, *utf8, &advance);
+        if(metrics.glyph > 0) {
+            int32_t currentY = heightData.ascent + metrics.y + offsetTextY;
+            maxY = std::max(maxY, currentY + metrics.height);
+            minY = std::min(minY, currentY);
+
+            int32_t currentX = metrics.x + offsetTextX;
+            maxX = std::max(maxX, currentX + std::max(metrics.width, metrics.advanceWidth));
+            minX = std::min(minX, currentX);
+
+            offsetTextX += advance;
+        }
+    }
+
     if(pRect != nullptr) {
         pRect->x      = minX;
         pRect->y      = minY;
@@ -191,6 +1019,403 @@ Font::GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect) {
     }
 }
 
+//-------------------------------------
+void
+Font::GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect) {
+    if(utf8 == nullptr || textHeight == 0)
+        return;
+
+    if(mTextCache.IsEnabled() && mStatus >= 0) {
+        const TextCache::Text &text = GetTextLayout(utf8, textHeight);
+        if(pRect != nullptr) {
+            *pRect = text.box;
+        }
+        return;
+    }
+
+    const HeightData &heightData = GetDataForHeight(textHeight);
+
+    MeasureTextBox(utf8, heightData, [&](uint32_t codePoint, char next, int32_t *pAdvance) -> const GlyphMetrics & {
+        const GlyphMetrics &metrics = GetGlyphMetrics(codePoint, textHeight);
+        if(metrics.glyph > 0) {
+            *pAdvance = metrics.advanceWidth + uint32_t(GetKerning(metrics.glyph, GetCodePointGlyph(next)) * heightData.scale);
+        }
+        return metrics;
+    }, pRect);
+}
+
+//-------------------------------------
+// Splits [0, count) in numThreads consecutive ranges: work(thread, begin, end) runs in new threads and the last one in this one
+template <typename Work>
+static void
+RunInThreads(uint32_t count, uint32_t numThreads, Work work) {
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for(uint32_t i = 0; i + 1 < numThreads; ++i) {
+        threads.emplace_back(work, i, uint32_t(uint64_t(count) * i / numThreads), uint32_t(uint64_t(count) * (i + 1) / numThreads));
+    }
+    work(numThreads - 1, uint32_t(uint64_t(count) * (numThreads - 1) / numThreads), count);
+
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+//-------------------------------------
+// 1. The threads gather the different (code point, next byte) pairs of their texts.
+// 2. This thread looks them up: metrics (new glyphs measured) and advance with the kerning.
+// 3. The threads measure their texts reading only that table.
+void
+Font::GetTextBoxes(const char * const *texts, uint32_t numTexts, uint8_t textHeight, Rect *pRects, uint32_t numThreads) {
+    static const uint32_t kMinTextsPerThread = 256;
+
+    struct Pair {
+        const GlyphMetrics  *metrics;
+        int32_t             advance;
+    };
+    using MapPair = FontHashMap<uint64_t, Pair>;
+
+    if(texts == nullptr || pRects == nullptr || textHeight == 0)
+        return;
+
+    FONT_TRACE_SCOPE("GetTextBoxes", "texts", numTexts);
+
+    if(numThreads == 0)
+        numThreads = std::min(std::thread::hardware_concurrency(), (numTexts + kMinTextsPerThread - 1) / kMinTextsPerThread);
+    numThreads = std::max(std::min(numThreads, numTexts), 1u);
+
+    const HeightData &heightData = GetDataForHeight(textHeight);
+
+    // The pairs of each thread (std allocator: the font one may not be thread safe)
+    std::vector<std::unordered_set<uint64_t>> threadPairs(numThreads);
+    RunInThreads(numTexts, numThreads, [&](uint32_t thread, uint32_t begin, uint32_t end) {
+        auto &pairs = threadPairs[thread];
+        for(uint32_t i = begin; i < end; ++i) {
+            const char *utf8 = texts[i];
+            uint32_t   codePoint;
+            if(utf8 == nullptr)
+                continue;
+
+            while((codePoint = GetNextUTF32(&utf8)) != 0) {
+                if(codePoint != '\n')
+                    pairs.insert((uint64_t(codePoint) << 8) | uint8_t(*utf8));
+            }
+        }
+    });
+
+    MapPair table { MapPair::allocator_type(mAllocator) };
+    for(const auto &pairs : threadPairs) {
+        for(uint64_t key : pairs) {
+            auto inserted = table.insert({key, Pair {}});
+            if(inserted.second == false)
+                continue;
+
+            const GlyphMetrics &metrics = GetGlyphMetrics(uint32_t(key >> 8), textHeight);
+            inserted.first->second.metrics = &metrics;
+            if(metrics.glyph > 0) {
+                inserted.first->second.advance = metrics.advanceWidth + uint32_t(GetKerning(metrics.glyph, GetCodePointGlyph(char(key & 0xff))) * heightData.scale);
+            }
+        }
+    }
+
+    RunInThreads(numTexts, numThreads, [&](uint32_t, uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i) {
+            if(texts[i] == nullptr)
+                continue;
+
+            MeasureTextBox(texts[i], heightData, [&](uint32_t codePoint, char next, int32_t *pAdvance) -> const GlyphMetrics & {
+                const Pair &pair = table.find((uint64_t(codePoint) << 8) | uint8_t(next))->second;
+                *pAdvance = pair.advance;
+                return *pair.metrics;
+            }, &pRects[i]);
+        }
+    });
+}
+
+//-------------------------------------
+// Same advances and kerning as DrawText
+void
+Font::LayoutCarets(const char *utf8, uint8_t textHeight, CaretLayout *pLayout) {
+    if(pLayout == nullptr)
+        return;
+
+    pLayout->Clear();
+    pLayout->mX.push_back(0);
+    pLayout->mOffsets.push_back(0);
+    pLayout->mLineStarts.push_back(0);
+    if(utf8 == nullptr || textHeight == 0)
+        return;
+
+    const HeightData &heightData = GetDataForHeight(textHeight);
+    const char       *begin      = utf8;
+    uint32_t         codePoint;
+    uint32_t         offsetTextX = 0;
+
+    pLayout->mLineHeight = heightData.ascent - heightData.descent;
+
+    FONT_TRACE_SCOPE("LayoutCarets");
+
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            pLayout->mLineStarts.push_back(uint32_t(pLayout->mX.size()));
+        }
+        else {
+            const GlyphMetrics &metrics = GetGlyphMetrics(codePoint, textHeight);
+            if(metrics.glyph > 0) {
+                offsetTextX += metrics.advanceWidth + uint32_t(GetKerning(metrics.glyph, GetCodePointGlyph(*utf8)) * heightData.scale);
+            }
+        }
+
+        pLayout->mX.push_back(int32_t(offsetTextX));
+        pLayout->mOffsets.push_back(uint32_t(utf8 - begin));
+    }
+}
+
+//-------------------------------------
+// Same layout as DrawText. Only measured (glyph metrics) without dst.
+int32_t
+Font::DrawRun(const char *begin, const char *end, char next, uint8_t textHeight, const Color32 &color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t baseline) {
+    const HeightData &heightData = GetDataForHeight(textHeight);
+    const char       *utf8       = begin;
+    uint32_t         codePoint;
+    uint32_t         offsetTextX = 0;
+
+    while(utf8 < end && (codePoint = GetNextUTF32(&utf8)) != 0) {
+        // The byte after the run stands for what follows it in the drawn string
+        char following = utf8 < end ? *utf8 : next;
+        if(dst == nullptr) {
+            const GlyphMetrics &metrics = GetGlyphMetrics(codePoint, textHeight);
+            if(metrics.glyph > 0) {
+                offsetTextX += metrics.advanceWidth + uint32_t(GetKerning(metrics.glyph, GetCodePointGlyph(following)) * heightData.scale);
+            }
+        }
+        else {
+            const CodePointHeightData &data = GetCodePointDataForHeight(codePoint, textHeight);
+            if(data.glyph > 0) {
+                CountBlit(BlitGlyph(mAtlas->GetPageTexture(data.page), mAtlas->GetPageWidth(), data.rect, data.rotated, posX + data.x + offsetTextX, baseline + data.y, color, dst, dstStride, mLeft, mTop, mRight, mBottom));
+                offsetTextX += data.advanceWidth + uint32_t(GetKerning(data.glyph, GetCodePointGlyph(following)) * heightData.scale);
+            }
+        }
+    }
+
+    return int32_t(offsetTextX);
+}
+
+//-------------------------------------
+// One pass over the line stores where each code point starts (pen and bytes). With it the width of any head + ellipsis + tail
+// is a sum: the head up to the ellipsis, the ellipsis followed by the tail, and the tail (its own advances and kerning).
+// The end cut stops the pass as soon as the line no longer fits.
+bool
+Font::MeasureFit(const char *utf8, uint8_t textHeight, int32_t maxWidth, ETruncate mode, TextFit *pFit) {
+    struct Entry {
+        uint32_t    offset;         // Of the code point in the text
+        int32_t     pen;            // Before it
+        int32_t     advance;        // Without the kerning (0: no glyph)
+        int32_t     glyph;
+    };
+
+    if(pFit == nullptr)
+        return false;
+
+    *pFit = {};
+    if(utf8 == nullptr || textHeight == 0 || mStatus < 0)
+        return false;
+
+    FONT_TRACE_SCOPE("MeasureFit");
+
+    const HeightData &heightData = GetDataForHeight(textHeight);
+    const char       *ellipsis   = GetCodePointGlyph(0x2026) != 0 ? "\xE2\x80\xA6" : "...";
+    const char       *ellipsisEnd = ellipsis + strlen(ellipsis);
+    uint32_t         lineEnd     = uint32_t(strcspn(utf8, "\n"));
+
+    ScratchScope scratch;
+    Entry *entries = reinterpret_cast<Entry *>(scratch.AllocateBytes((size_t(lineEnd) + 1) * sizeof(Entry)));
+    if(entries == nullptr)
+        return false;
+
+    const char *text = utf8;
+    const char *end  = utf8 + lineEnd;
+    uint32_t   count = 0;
+    uint32_t   codePoint;
+    int32_t    pen   = 0;
+    bool       fits  = true;
+    while(text < end) {
+        uint32_t offset = uint32_t(text - utf8);
+        if((codePoint = GetNextUTF32(&text)) == 0)
+            break;
+
+        const GlyphMetrics &metrics = GetGlyphMetrics(codePoint, textHeight);
+        Entry &entry = entries[count++];
+        entry = { offset, pen, 0, metrics.glyph };
+        if(metrics.glyph > 0) {
+            entry.advance = metrics.advanceWidth;
+            pen += int32_t(metrics.advanceWidth + uint32_t(GetKerning(metrics.glyph, GetCodePointGlyph(*text)) * heightData.scale));
+        }
+        if(pen > maxWidth) {
+            fits = false;
+            if(mode == ETruncate::End)
+                break;
+        }
+    }
+    entries[count] = { uint32_t(text - utf8), pen, 0, 0 };
+
+    pFit->lineEnd = lineEnd;
+    if(fits) {
+        pFit->headEnd   = lineEnd;
+        pFit->tailBegin = lineEnd;
+        pFit->width     = pen;
+        return true;
+    }
+
+    // Head: the code points before k, followed by the ellipsis
+    auto headWidth = [&](uint32_t k) -> int32_t {
+        if(k == 0)
+            return 0;
+        const Entry &last = entries[k - 1];
+        if(last.glyph <= 0)
+            return last.pen;
+        return last.pen + int32_t(last.advance + uint32_t(GetKerning(last.glyph, GetCodePointGlyph(*ellipsis)) * heightData.scale));
+    };
+    // Ellipsis followed by the tail from i (count: no tail)
+    auto tailWidth = [&](uint32_t i) -> int32_t {
+        char next = i < count ? utf8[entries[i].offset] : utf8[lineEnd];
+        return DrawRun(ellipsis, ellipsisEnd, next, textHeight, Color32 {}, nullptr, 0, 0, 0) + (i < count ? pen - entries[i].pen : 0);
+    };
+
+    int32_t  head = 0, tail = tailWidth(count);
+    uint32_t k = 0, i = count;
+    if(tail > maxWidth)
+        return false;
+
+    switch(mode) {
+        case ETruncate::End:
+            // The pass stopped at the first code point beyond the width
+            for(k = count; k > 0 && (head = headWidth(k)) + tail > maxWidth; --k) { }
+            if(k == 0)
+                head = 0;
+            break;
+
+        case ETruncate::Start:
+            for(i = 0; i < count && (tail = tailWidth(i)) > maxWidth; ++i) { }
+            if(i == count)
+                tail = tailWidth(count);
+            break;
+
+        case ETruncate::Middle: {
+            // Half of the width for the head, the rest for the tail
+            int32_t half = (maxWidth - tailWidth(count)) / 2;
+            while(k < count && headWidth(k + 1) <= half) {
+                ++k;
+            }
+            head = headWidth(k);
+            for(i = k; i < count && head + (tail = tailWidth(i)) > maxWidth; ++i) { }
+            if(i == count)
+                tail = tailWidth(count);
+            break;
+        }
+    }
+
+    pFit->headEnd   = entries[k].offset;
+    pFit->tailBegin = i < count ? entries[i].offset : lineEnd;
+    pFit->width     = head + tail;
+    pFit->truncated = true;
+
+    return true;
+}
+
+//-------------------------------------
+int32_t
+Font::DrawTextFit(const char *utf8, uint8_t textHeight, int32_t maxWidth, ETruncate mode, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) {
+    TextFit fit;
+    if(dst == nullptr || MeasureFit(utf8, textHeight, maxWidth, mode, &fit) == false)
+        return 0;
+
+    FONT_TRACE_SCOPE("DrawTextFit");
+    CountDrawCall();
+
+    Color32    fontColor = *reinterpret_cast<Color32 *>(&color);
+    int32_t    baseline  = posY + GetDataForHeight(textHeight).ascent;
+    const char *ellipsis = GetCodePointGlyph(0x2026) != 0 ? "\xE2\x80\xA6" : "...";
+    const char *lineEnd  = utf8 + fit.lineEnd;
+    int32_t    x         = posX;
+
+    if(fit.truncated == false) {
+        DrawRun(utf8, lineEnd, *lineEnd, textHeight, fontColor, dst, dstStride, x, baseline);
+        return fit.width;
+    }
+
+    x += DrawRun(utf8, utf8 + fit.headEnd, *ellipsis, textHeight, fontColor, dst, dstStride, x, baseline);
+    x += DrawRun(ellipsis, ellipsis + strlen(ellipsis), utf8[fit.tailBegin], textHeight, fontColor, dst, dstStride, x, baseline);
+    DrawRun(utf8 + fit.tailBegin, lineEnd, *lineEnd, textHeight, fontColor, dst, dstStride, x, baseline);
+
+    return fit.width;
+}
+
+//-------------------------------------
+// Same layout as DrawText and GetTextBox, from the text cache or done now (and cached when every glyph is in the atlas)
+const TextCache::Text &
+Font::GetTextLayout(const char *utf8, uint8_t height) {
+    size_t   length = strlen(utf8);
+    uint64_t key    = TextCache::GetKey(utf8, length, height, mRenderConfig);
+
+    const TextCache::Text *text = mTextCache.Find(key, utf8, length);
+    if(text != nullptr)
+        return *text;
+
+    FONT_TRACE_SCOPE("LayoutText");
+
+    const HeightData          &heightData = GetDataForHeight(height);
+    const CodePointHeightData *trash      = &mCodePointHeightData[0];
+    const char                *end        = utf8 + length;
+    uint32_t                  codePoint;
+    int32_t                   offsetTextX = 0, offsetTextY = 0;
+    int32_t                   minX = 0xffff, maxX = 0;
+    int32_t                   minY = 0xffff, maxY = 0;
+    bool                      complete = true;
+
+    mTextLayout.glyphs.clear();
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            offsetTextY += (heightData.ascent - heightData.descent);
+            maxY = 0;
+            continue;
+        }
+
+        const CodePointHeightData &data = GetCodePointDataForHeight(codePoint, height);
+        if(data.glyph > 0) {
+            TextCache::Glyph glyph { &data, data.x + offsetTextX, data.y + offsetTextY };
+            mTextLayout.glyphs.push_back(glyph);
+
+            int32_t currentY = heightData.ascent + glyph.y;
+            maxY = std::max(maxY, currentY + data.GetHeight());
+            minY = std::min(minY, currentY);
+            maxX = std::max(maxX, glyph.x + std::max(data.GetWidth(), data.advanceWidth));
+            minX = std::min(minX, glyph.x);
+
+            offsetTextX += data.advanceWidth + uint32_t(GetKerning(data.glyph, GetCodePointGlyph(*utf8)) * heightData.scale);
+        }
+        else if(&data == trash && GetCodePointGlyph(codePoint) != 0) {
+            // The atlas is full: it may fit later
+            complete = false;
+        }
+    }
+
+    mTextLayout.box.x      = minX;
+    mTextLayout.box.y      = minY;
+    mTextLayout.box.width  = maxX - 1;
+    mTextLayout.box.height = maxY - 1;
+
+    if(complete) {
+        text = mTextCache.Add(key, end - length, length, mTextLayout.glyphs, mTextLayout.box);
+        if(text != nullptr)
+            return *text;
+    }
+
+    return mTextLayout;
+}
+
 // TODO: Think where put these funcs...
 //---------------------------------
 static inline uint8_t
@@ -275,6 +1500,8 @@ GetAAColor(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_
 //-------------------------------------
 void
 Font::AABlock(uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, uint32_t dstStride) {
+    FONT_TRACE_SCOPE("AABlock");
+
     uint32_t x, y;
     uint32_t offset;
 
@@ -298,6 +1525,8 @@ Font::AABlock(uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, uint3
 //-------------------------------------
 void
 Font::AABlockEx(uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, uint32_t dstStride) {
+    FONT_TRACE_SCOPE("AABlockEx");
+
     int32_t x, y;
     int32_t offset, offsetY;
 
@@ -7,11 +7,19 @@
 // See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
 //-----------------------------------------------------------------------------
 
+#include "AtlasManager.h"
+#include "CaretLayout.h"
+#include "FontAllocator.h"
+#include "FontFace.h"
+#include "FontStats.h"
 #include "SkylineBinPack.h"
+#include "TextCache.h"
 //-------------------------------------
 #include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 //-------------------------------------
 namespace MindShake {
@@ -39,7 +47,21 @@ namespace MindShake {
         int     advanceWidth;
         int     leftSideBearing;
         int     x, y;
+        uint32_t page;              // Atlas page of rect
         Rect    rect;
+        bool    rotated;            // Stored transposed (rect is height x width)
+
+        int32_t GetWidth() const    { return rotated ? rect.height : rect.width;  }
+        int32_t GetHeight() const   { return rotated ? rect.width  : rect.height; }
+    };
+
+    //---------------------------------
+    // Box and advance of a glyph at a height, without its bitmap (text measurement)
+    struct GlyphMetrics {
+        int     glyph;
+        int     advanceWidth;
+        int     x, y;
+        int32_t width, height;      // Of the bitmap it gets in the atlas
     };
 
     //-------------------------------------
@@ -53,76 +75,271 @@ namespace MindShake {
     };
 
     //-------------------------------------
+    // Cell of a monospace grid (DrawCells)
+    struct Cell {
+        uint32_t    codePoint;      // 0 or ' ': just the background
+        uint32_t    fg;
+        uint32_t    bg;             // Alpha 0: not filled
+
+        bool        operator == (const Cell &other) const   { return codePoint == other.codePoint && fg == other.fg && bg == other.bg; }
+        bool        operator != (const Cell &other) const   { return !(*this == other);                                                }
+    };
+
+    //-------------------------------------
+    // Layer drawn under the text (DrawText with a TextEffect)
+    enum class ETextEffect : uint8_t {
+        None,
+        Outline,        // Coverage dilated by the radius
+        Shadow,         // Coverage blurred by the radius
+        Glow,           // Coverage dilated and blurred by the radius
+    };
+
+    //-------------------------------------
+    struct TextEffect {
+        ETextEffect type;
+        uint8_t     radius;         // Up to 63 pixels (0: the glyphs themselves, e.g. a hard shadow)
+        uint32_t    color;
+        int32_t     offsetX;        // Of the effect layer (e.g. a drop shadow)
+        int32_t     offsetY;
+    };
+
+    //-------------------------------------
+    // Where a text that doesn't fit is cut (DrawTextFit)
+    enum class ETruncate : uint8_t {
+        End,            // "Long te…"
+        Middle,         // "Long…ext"
+        Start,          // "…ng text"
+    };
+
+    //-------------------------------------
+    // Text fitted in a width: utf8[0, headEnd) + ellipsis + utf8[tailBegin, lineEnd) (byte offsets)
+    struct TextFit {
+        uint32_t    headEnd;
+        uint32_t    tailBegin;
+        uint32_t    lineEnd;        // Of the first line (the text is drawn up to it)
+        int32_t     width;          // Advance of the fitted text
+        bool        truncated;      // With the ellipsis
+    };
+
+    //-------------------------------------
+    // Glyph cache key
     union CodePointHeight {
-        uint32_t     value;
+        uint64_t     value;
         struct {
-            uint32_t codePoint : 24;
-            uint32_t height    :  8;
+            uint64_t codePoint : 24;
+            uint64_t height    :  8;
+            uint64_t config    :  8;   // Render config the glyph was rasterized with (antialias settings)
+            uint64_t effect    :  2;   // ETextEffect of the variant (None: the glyph itself)
+            uint64_t radius    :  6;   // Of the effect
         };
     };
 
+    //-------------------------------------
+    // Antialias settings of the rendered glyphs (all zero without antialias)
+    struct RenderConfig {
+        int32_t center;
+        int32_t border;
+        int32_t corner;
+        bool    useAntialias;
+        bool    allowEx;
+
+        bool    operator == (const RenderConfig &other) const {
+            return center == other.center && border == other.border && corner == other.corner && useAntialias == other.useAntialias && allowEx == other.allowEx;
+        }
+    };
+
 
     //-------------------------------------
-    class Font {
+    class Font : public AtlasClient {
+        friend class FontBaker;
+        friend class FontCollection;
+        friend class SharedAtlas;
+
+        public:
+            using ELevelChoiceHeuristic  = MindShake::SkylineBinPack::ELevelChoiceHeuristic;
+
         protected:
-            using MapHeightData          = std::unordered_map<uint32_t, HeightData>;
-            using MapCodePointData       = std::unordered_map<int32_t, CodePointData>;
-            using MapCodePointHeightData = std::unordered_map<uint32_t, CodePointHeightData>;
-            using MapKerning             = std::unordered_map<uint64_t, int32_t>;
+            using MapHeightData          = FontHashMap<uint32_t, HeightData>;
+            using MapCodePointData       = FontHashMap<int32_t, CodePointData>;
+            using MapCodePointHeightData = FontHashMap<uint64_t, CodePointHeightData>;
+            using MapGlyphMetrics        = FontHashMap<uint64_t, GlyphMetrics>;
+            using MapKerning             = FontHashMap<uint64_t, int32_t>;
+            using VecRenderConfig        = FontVector<RenderConfig>;
             using SkylineBinPack         = MindShake::SkylineBinPack;
             using Rect                   = SkylineBinPack::Rect;
-            using ELevelChoiceHeuristic  = SkylineBinPack::ELevelChoiceHeuristic;
 
         public:
-            explicit                    Font(const char *fontName);
-            
+            // The caches and the font data come from the allocator (nullptr: FontAllocator::GetDefault()).
+            // Given one, the own atlas also takes its pages from it, 512 x 512 each.
+            explicit                    Font(const char *fontName, FontAllocator *allocator = nullptr);
+            // Over a face already loaded (see FontFace): nothing is read nor parsed, only the caches are created
+            explicit                    Font(FontFace *face, FontAllocator *allocator = nullptr);
+            virtual                     ~Font();
+
             uint8_t                     GetStatus() const                   { return mStatus;                           }
             void                        Reset();                            // Remove all rendered glyphs and associated data!
+            void                        ReleaseHeight(uint8_t height);      // Remove the rendered glyphs of one height (RepackAtlas recovers the space)
+            void                        ReleaseOtherRenderConfigs();        // Remove the glyphs rendered with other antialias settings than the current ones
+            // Renders the code points of utf8 at every height in one go: the boxes are measured first and packed
+            // tallest first, and each atlas page is resized once. Returns the number of glyphs added.
+            uint32_t                    PreloadGlyphs(const char *utf8, const uint8_t *heights, uint32_t numHeights);
+            // Repacks the atlas without the released glyphs, working at most timeBudgetMs per call (<= 0 means until done).
+            // Returns true when finished. Meanwhile the font keeps drawing from the current atlas.
+            bool                        RepackAtlas(float timeBudgetMs = 0.0f);
+
+            const FontString &          GetFontName() const                 { return mFontName;                         }
+            FontAllocator *             GetAllocator() const                { return mAllocator;                        }
+            // To make more fonts of the same file cheaply (nullptr without memory for it)
+            FontFace *                  GetFace() const                     { return mFace;                             }
+
+            // The glyphs are packed in the pages of an atlas. By default each font has its own one.
+            // A shared atlas must outlive the font. Changing the atlas removes all rendered glyphs.
+            void                        SetAtlas(AtlasManager *atlas);
+            AtlasManager *              GetAtlas() const                    { return mAtlas;                            }
+            uint32_t                    GetNumTextures() const              { return mAtlas->GetNumPages();             }
+            uint8_t *                   GetTexture(uint32_t page = 0) const { return mAtlas->GetPageTexture(page);      }
+            uint32_t                    GetTextureWidth() const             { return mAtlas->GetPageWidth();            }
+            uint32_t                    GetTextureHeight(uint32_t page = 0) const   { return mAtlas->GetPageHeight(page);   }
+            // Texture areas changed since the last call, to upload only the new glyphs (the atlas keeps a single list even when shared)
+            FontVector<AtlasManager::DirtyRegion>   ConsumeDirtyRegions()   { return mAtlas->ConsumeDirtyRegions();     }
 
-            const std::string &         GetFontName() const                 { return mFontName;                         }
-            uint8_t *                   GetTexture() const                  { return mTexture;                          }
-            uint32_t                    GetTextureWidth() const             { return mPacker.GetWidth();                }
-            uint32_t                    GetTextureHeight() const            { return mPacker.GetHeight();               }
+            // Packing options of the atlas (shared by all the fonts using it). They apply to the glyphs rendered from now on.
+            void                        SetPackingHeuristic(ELevelChoiceHeuristic heuristic)    { mAtlas->SetHeuristic(heuristic);  }
+            ELevelChoiceHeuristic       GetPackingHeuristic() const         { return mAtlas->GetHeuristic();            }
+            void                        SetGlyphRotation(bool set)          { mAtlas->SetAllowRotation(set);            }
+            bool                        GetGlyphRotation() const            { return mAtlas->GetAllowRotation();        }
+            void                        SetPackingWasteMap(bool set)        { mAtlas->SetUseWasteMap(set);              }
+            bool                        GetPackingWasteMap() const          { return mAtlas->GetUseWasteMap();          }
 
             void                        DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY);
+            // Measured with the glyph metrics only (outline boxes and advances, cached per glyph and height): nothing is
+            // rasterized nor added to the atlas. With the text cache enabled the text is laid out (and cached) for DrawText.
             void                        GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect);
+            // GetTextBox of many texts (e.g. sizing the cells of a table), measured in parallel by numThreads (0: one per core).
+            // The glyphs and kerning pairs not seen yet are looked up first, then the threads only read them.
+            // The font can't be used from other threads meanwhile.
+            void                        GetTextBoxes(const char * const *texts, uint32_t numTexts, uint8_t textHeight, Rect *pRects, uint32_t numThreads = 0);
+            // The text over an effect layer in a single call, instead of drawing it several times with offsets. The effect of
+            // each glyph is a variant rendered once from its coverage and cached in the atlas like the glyph (and released with it).
+            // The effects of the whole text go under all the fills, so a glyph never covers its neighbours.
+            void                        DrawText(const char *utf8, uint8_t textHeight, uint32_t color, const TextEffect &effect, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY);
+
+            // The first line of the text fitted in maxWidth pixels of advance (the kerning included): when it doesn't fit it is cut
+            // where the mode says and an ellipsis ('…', or "..." if the font lacks it) takes the place of the code points removed.
+            // The cut is found in one pass over the glyph metrics (nothing is rasterized) and the parts are drawn from the text
+            // itself, without building a new string. MeasureFit returns false when not even the ellipsis fits (nothing to draw).
+            bool                        MeasureFit(const char *utf8, uint8_t textHeight, int32_t maxWidth, ETruncate mode, TextFit *pFit);
+            // Draws what DrawText would draw for the fitted string. Returns its advance.
+            int32_t                     DrawTextFit(const char *utf8, uint8_t textHeight, int32_t maxWidth, ETruncate mode, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY);
+
+            // Caret positions of the text (see CaretLayout) for hit testing, carets and selections in editors: one pass
+            // over the text, then every query is a binary search instead of measuring prefixes with GetTextBox.
+            void                        LayoutCarets(const char *utf8, uint8_t textHeight, CaretLayout *pLayout);
+
+            // Monospace grid of columns x rows cells (row after row) drawn with fixed advances and without kerning (e.g. a terminal).
+            // Each cell is filled with its background and its glyph is clipped to it (and to the clipping area).
+            // Given the cells of the previous call, only the changed ones are drawn. Returns the number of cells drawn.
+            uint32_t                    DrawCells(const Cell *cells, uint32_t columns, uint32_t rows, uint8_t textHeight, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY, const Cell *previous = nullptr);
+            // Advance of 'M' and line height
+            void                        GetCellSize(uint8_t textHeight, uint32_t *pWidth, uint32_t *pHeight);
+
+            // Opt-in cache of laid out strings for DrawText and GetTextBox, for the texts repeated every frame: a hit skips
+            // the UTF-8 decoding, the glyph lookups and the kerning. Bounded to about maxBytes (0, the default, disables it).
+            // Strings with glyphs that could not be added to the atlas are not cached.
+            void                        SetTextCacheSize(size_t maxBytes)   { mTextCache.SetMaxBytes(maxBytes);         }
+            size_t                      GetTextCacheSize() const            { return mTextCache.GetMaxBytes();          }
+            TextCache::Stats            GetTextCacheStats() const           { return mTextCache.GetStats();             }
+            void                        ResetTextCacheStats()               { mTextCache.ResetStats();                  }
 
             void                        SetClipping(int32_t left, int32_t top, int32_t right, int32_t bottom)   { mLeft = left; mRight = right; mTop = top; mBottom = bottom; }
+            void                        GetClipping(int32_t *left, int32_t *top, int32_t *right, int32_t *bottom) const  { *left = mLeft; *right = mRight; *top = mTop; *bottom = mBottom; }
 
-            void                        SetAntialias(bool set)              { mUseAntialias = set;                      }
+            // Glyphs are cached per antialias settings, so changing them keeps the glyphs already rendered with the
+            // other ones (up to 255 different settings, then the font is reset).
+            void                        SetAntialias(bool set)              { mUseAntialias = set; UpdateRenderConfig();        }
             bool                        GetAntialias() const                { return mUseAntialias;                     }
-            void                        SetAntialiasAllowEx(bool set)       { mAntialiasAllowEx = set;                  }
+            void                        SetAntialiasAllowEx(bool set)       { mAntialiasAllowEx = set; UpdateRenderConfig();    }
             bool                        GetAntialiasAllowEx() const         { return mAntialiasAllowEx;                 }
-            void                        SetAntialiasWeights(int32_t center, int32_t border, int32_t corner)     { mAACenter = center; mAABorder = border; mAACorner = corner;  }
+            void                        SetAntialiasWeights(int32_t center, int32_t border, int32_t corner)     { mAACenter = center; mAABorder = border; mAACorner = corner; UpdateRenderConfig(); }
             int32_t                     GetAntialiasCenter() const          { return mAACenter;                         }
             int32_t                     GetAntialiasBorder() const          { return mAABorder;                         }
             int32_t                     GetAntialiasCorner() const          { return mAACorner;                         }
 
+            // Glyph cache, kerning and drawing counters. Only collected with FONT_RENDERER_STATS (see FontStats.h).
+            const FontStats &           GetStats() const                    { return mStats;                            }
+            void                        ResetStats()                        { mStats = FontStats {};                    }
+            void                        SetEventCallback(FontEventCallback callback, void *userData)   { mEventCallback = callback; mEventUserData = userData; }
+
+            // Consistency checks (for tests): the atlas, and the pixels of every rendered glyph against a new
+            // rasterization with the current settings. Reports the first problem found to stderr.
+            bool                        Validate();
+
         protected:
-            bool                        InitPacker();
+            // Glyph measured but not rendered yet
+            struct GlyphBox {
+                CodePointHeightData data;
+                int32_t             rawWidth, rawHeight;    // Given by the backend
+                int32_t             width, height;          // Of the bitmap in the atlas
+                bool                isEmpty;
+                ETextEffect         effect;
+                int32_t             radius;
+                int32_t             padding;                // Around the glyph for the effect
+            };
+
+            bool                        InitFace();                         // Status and metrics of the face
+            bool                        InitPacker(AtlasManager *atlas = nullptr);  // Our own atlas if none is given
+            void                        UpdateRenderConfig();
+            void                        ApplyRenderConfig(const RenderConfig &config);
             float                       GetScaleForHeight(uint8_t height)   { return GetDataForHeight(height).scale;    }
             uint32_t                    GetCodePointGlyph(uint32_t index)   { return GetCodePointData(index).glyph;     }
             void                        AABlock(uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, uint32_t dstStride);
             void                        AABlockEx(uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, uint32_t dstStride);
+            static uint32_t             BlitGlyph(const uint8_t *texture, uint32_t textureStride, const Rect &rect, bool rotated, int32_t currentX, int32_t currentY, const Color32 &fontColor, uint32_t *dst, uint32_t dstStride, int32_t clipLeft, int32_t clipTop, int32_t clipRight, int32_t clipBottom);
             const HeightData &          GetDataForHeight(uint8_t height);
+            bool                        AddGlyphToAtlas(uint64_t key, const uint8_t *pixels, int32_t width, int32_t height, CodePointHeightData *pData);
+            void                        CopyGlyphToAtlas(const uint8_t *pixels, int32_t width, int32_t height, const CodePointHeightData &data);
+
+            const CodePointHeightData & GetCodePointDataForHeight(uint32_t index, uint8_t height, ETextEffect effect = ETextEffect::None, uint8_t radius = 0);
+            const GlyphMetrics &        GetGlyphMetrics(uint32_t index, uint8_t height);
+            const TextCache::Text &     GetTextLayout(const char *utf8, uint8_t height);
+            // Advance of utf8[begin, end) followed by the byte next (kerning), drawn at the baseline if dst is given
+            int32_t                     DrawRun(const char *begin, const char *end, char next, uint8_t textHeight, const Color32 &color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t baseline);
+            bool                        MeasureGlyph(uint32_t index, uint8_t height, GlyphBox *pBox, ETextEffect effect = ETextEffect::None, uint8_t radius = 0);
+            uint8_t *                   RasterizeGlyph(const GlyphBox &box, uint8_t height);
+            uint8_t *                   RasterizeEffect(const GlyphBox &box, uint8_t height);
+
+            void                        OnAtlasRegionMoved(uint64_t key, uint32_t page, const Rect &rect) override;
+
+            // Stats hooks (empty without FONT_RENDERER_STATS)
+            void                        CountGlyphLookup(bool hit);
+            void                        CountKerningLookup(bool hit);
+            void                        CountBlit(uint32_t pixels);
+            void                        CountFill(uint32_t pixels);     // Background, no glyph
+            void                        CountDrawCall();
+            void                        AddEvent(EFontEvent event, const StatsTimer &timer, int32_t glyph, uint8_t height);
 
         protected:
             virtual int                         GetKerning(uint32_t char1, uint32_t char2) = 0;
 
             virtual const CodePointData &       GetCodePointData(uint32_t index) = 0;
-            virtual const CodePointHeightData & GetCodePointDataForHeight(uint32_t index, uint8_t height) = 0;
+            // Metrics of the glyph at the given height (pData) and size of its bitmap
+            virtual bool                        GetGlyphBox(const CodePointData &codePoint, uint8_t height, CodePointHeightData *pData, int32_t *pWidth, int32_t *pHeight) = 0;
+            virtual bool                        RenderGlyph(int glyph, uint8_t textHeight, uint8_t *pixels, int32_t width, int32_t height) = 0;
 
         protected:
-            std::string            mFontName;
-            SkylineBinPack         mPacker;
-            uint8_t                *mTexture {};
+            FontAllocator          *mAllocator {};
+            bool                   mOwnAllocator {};       // Given to the constructor
+            FontString             mFontName;
+            AtlasManager           mOwnAtlas;
+            AtlasManager           *mAtlas {};
             int                    mAscent  {};
             int                    mDescent {};
             int                    mLineGap {};
             MapHeightData          mHeightData;
             MapCodePointData       mCodePointData;
             MapCodePointHeightData mCodePointHeightData;
-            MapKerning             mKerningData;
+            MapGlyphMetrics        mGlyphMetrics;          // Measured glyphs (GetTextBox, LayoutCarets), rendered or not
+            FontFace               *mFace {};              // One reference
 
             int32_t                mLeft   { -0xffff };
             int32_t                mTop    { -0xffff };
@@ -135,7 +352,72 @@ namespace MindShake {
             int32_t                mAACorner {  1 };
             bool                   mUseAntialias { false };
             bool                   mAntialiasAllowEx { false };
+            VecRenderConfig        mRenderConfigs;         // Index = CodePointHeight::config
+            uint8_t                mRenderConfig { 0 };    // Of the current settings
+            TextCache              mTextCache;
+            TextCache::Text        mTextLayout;            // Laid out text not cached
+
+            FontStats              mStats {};
+            FontEventCallback      mEventCallback {};
+            void                   *mEventUserData {};
     };
 
+    //-------------------------------------
+    inline void
+    Font::CountGlyphLookup(bool hit) {
+#if FONT_RENDERER_STATS
+        ++(hit ? mStats.glyphHits : mStats.glyphMisses);
+#endif
+    }
+
+    //-------------------------------------
+    inline void
+    Font::CountKerningLookup(bool hit) {
+#if FONT_RENDERER_STATS
+        ++(hit ? mStats.kerningHits : mStats.kerningMisses);
+#endif
+    }
+
+    //-------------------------------------
+    inline void
+    Font::CountBlit(uint32_t pixels) {
+#if FONT_RENDERER_STATS
+        ++mStats.glyphsDrawn;
+        mStats.bytesBlended += pixels * sizeof(uint32_t);
+#endif
+    }
+
+    //-------------------------------------
+    inline void
+    Font::CountFill(uint32_t pixels) {
+#if FONT_RENDERER_STATS
+        mStats.bytesBlended += pixels * sizeof(uint32_t);
+#endif
+    }
+
+    //-------------------------------------
+    inline void
+    Font::CountDrawCall() {
+#if FONT_RENDERER_STATS
+        ++mStats.drawCalls;
+#endif
+    }
+
+    //-------------------------------------
+    inline void
+    Font::AddEvent(EFontEvent event, const StatsTimer &timer, int32_t glyph, uint8_t height) {
+#if FONT_RENDERER_STATS
+        uint64_t ns = timer.GetElapsedNs();
+        switch(event) {
+            case EFontEvent::Rasterize:     mStats.rasterizeTime.Add(ns);   break;
+            case EFontEvent::Antialias:     mStats.antialiasTime.Add(ns);   break;
+            case EFontEvent::AtlasResize:   ++mStats.atlasResizes;          break;
+        }
+        if(mEventCallback != nullptr) {
+            mEventCallback(event, glyph, height, ns, mEventUserData);
+        }
+#endif
+    }
+
 } // end of namespace
 //-------------------------------------
@@ -0,0 +1,246 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontACC.h"
+#include "FontTrace.h"
+#include "ScratchArena.h"
+//-------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define FONT_ACC_SSE2   1
+#else
+    #define FONT_ACC_SSE2   0
+#endif
+
+using namespace MindShake;
+
+//-------------------------------------
+// Flattened curves: the segments stay within about this distance (pixels) of the curve
+static const float  kTolerance   = 0.1f;
+static const int    kMaxSegments = 64;
+
+//-------------------------------------
+// Coverage deltas of the glyph, row after row (and two more cells: the right edge of the last row)
+struct Cells {
+    float       *data;
+    int32_t     width;
+    int32_t     height;
+};
+
+//-------------------------------------
+// Adds the signed area of the edge to the cells of each row it crosses (font-rs)
+static void
+DrawLine(Cells &cells, float x0, float y0, float x1, float y1) {
+    if(y0 == y1)
+        return;
+
+    float dir = 1.0f;
+    if(y0 > y1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1.0f;
+    }
+
+    float   dxdy   = (x1 - x0) / (y1 - y0);
+    float   x      = x0;
+    int32_t yBegin = int32_t(y0);
+    int32_t yEnd   = std::min(int32_t(std::ceil(y1)), cells.height);
+
+    for(int32_t y=yBegin; y<yEnd; ++y) {
+        float   *line = cells.data + size_t(y) * cells.width;
+        float   dy    = std::min(float(y + 1), y1) - std::max(float(y), y0);
+        float   xNext = x + dxdy * dy;
+        float   d     = dy * dir;
+        float   left  = std::min(x, xNext);
+        float   right = std::max(x, xNext);
+        float   leftFloor = std::floor(left);
+        int32_t leftIndex = int32_t(leftFloor);
+        float   rightCeil = std::ceil(right);
+        int32_t rightIndex = int32_t(rightCeil);
+
+        if(rightIndex <= leftIndex + 1) {
+            // Within a cell: the area right of the edge goes to the next one
+            float middle = 0.5f * (x + xNext) - leftFloor;
+            line[leftIndex]     += d - d * middle;
+            line[leftIndex + 1] += d * middle;
+        }
+        else {
+            float step      = 1.0f / (right - left);
+            float leftFrac  = left - leftFloor;
+            float areaLeft  = 0.5f * step * (1.0f - leftFrac) * (1.0f - leftFrac);
+            float rightFrac = right - rightCeil + 1.0f;
+            float areaRight = 0.5f * step * rightFrac * rightFrac;
+
+            line[leftIndex] += d * areaLeft;
+            if(rightIndex == leftIndex + 2) {
+                line[leftIndex + 1] += d * (1.0f - areaLeft - areaRight);
+            }
+            else {
+                float area = step * (1.5f - leftFrac);
+                line[leftIndex + 1] += d * (area - areaLeft);
+                for(int32_t i=leftIndex + 2; i<rightIndex - 1; ++i) {
+                    line[i] += d * step;
+                }
+                area += float(rightIndex - leftIndex - 3) * step;
+                line[rightIndex - 1] += d * (1.0f - area - areaRight);
+            }
+            line[rightIndex] += d * areaRight;
+        }
+
+        x = xNext;
+    }
+}
+
+//-------------------------------------
+static inline int
+GetNumSegments(float ddx, float ddy, float factor) {
+    float error = std::sqrt(ddx * ddx + ddy * ddy) * factor;
+    return std::min(1 + int(std::sqrt(error / kTolerance)), kMaxSegments);
+}
+
+//-------------------------------------
+// Prefix sum of the deltas: |coverage| clamped to 1 (non zero winding for non overlapping contours)
+static void
+AccumulateCells(const float *cells, size_t count, uint8_t *pixels) {
+    size_t i   = 0;
+    float  sum = 0.0f;
+
+#if FONT_ACC_SSE2
+    const __m128 one      = _mm_set1_ps(1.0f);
+    const __m128 scale    = _mm_set1_ps(255.0f);
+    const __m128 half     = _mm_set1_ps(0.5f);
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128       offset   = _mm_setzero_ps();
+
+    for(; i + 4 <= count; i += 4) {
+        // In-register prefix sum of 4 cells, plus the sum of the previous ones
+        __m128 x = _mm_loadu_ps(cells + i);
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+        x = _mm_add_ps(x, offset);
+        offset = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m128  coverage = _mm_min_ps(_mm_and_ps(x, signMask), one);
+        __m128i values   = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, scale), half));
+        values = _mm_packs_epi32(values, values);
+        values = _mm_packus_epi16(values, values);
+
+        uint32_t four = uint32_t(_mm_cvtsi128_si32(values));
+        memcpy(pixels + i, &four, sizeof(four));
+    }
+    sum = _mm_cvtss_f32(offset);
+#endif
+
+    for(; i < count; ++i) {
+        sum += cells[i];
+        pixels[i] = uint8_t(std::min(std::fabs(sum), 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+//-------------------------------------
+FontACC::FontACC(const char *fontName, FontAllocator *allocator) : FontSTB(fontName, allocator) {
+}
+
+//-------------------------------------
+FontACC::FontACC(FontFace *face, AtlasManager *atlas, FontAllocator *allocator) : FontSTB(face, atlas, allocator) {
+}
+
+//-------------------------------------
+FontACC::~FontACC() {
+}
+
+//-------------------------------------
+bool
+FontACC::RenderGlyph(int glyph, uint8_t textHeight, uint8_t *pixels, int32_t width, int32_t height) {
+    const Outline &outline = GetGlyphOutline(glyph);
+    if(width <= 0 || height <= 0 || outline.empty())
+        return true;
+
+    FONT_TRACE_SCOPE("acc_Rasterize", "glyph", glyph, "height", textHeight);
+
+    ScratchScope scratch;
+
+    size_t count = size_t(width) * height;
+    Cells  cells { static_cast<float *>(ScratchArena::GetThreadArena().Allocate((count + 2) * sizeof(float))), width, height };
+    if(cells.data == nullptr)
+        return false;
+    memset(cells.data, 0, (count + 2) * sizeof(float));
+
+    // Font units (y up) to bitmap pixels (y down), kept inside the bitmap
+    float   scale = GetScaleForHeight(textHeight);
+    int32_t originX, originY;
+    GetGlyphOrigin(glyph, textHeight, &originX, &originY);
+
+    auto toX = [&](float x) { return std::min(std::max(x * scale - float(originX), 0.0f), float(width));  };
+    auto toY = [&](float y) { return std::min(std::max(-y * scale - float(originY), 0.0f), float(height)); };
+
+    float startX = 0.0f, startY = 0.0f;
+    float x = 0.0f, y = 0.0f;
+    for(const stbtt_vertex &vertex : outline) {
+        float nextX = toX(vertex.x);
+        float nextY = toY(vertex.y);
+
+        switch(vertex.type) {
+            case STBTT_vmove:
+                DrawLine(cells, x, y, startX, startY);     // Close the previous contour
+                startX = nextX;
+                startY = nextY;
+                break;
+
+            case STBTT_vline:
+                DrawLine(cells, x, y, nextX, nextY);
+                break;
+
+            case STBTT_vcurve: {
+                float cx = toX(vertex.cx), cy = toY(vertex.cy);
+                int   n  = GetNumSegments(x - 2.0f * cx + nextX, y - 2.0f * cy + nextY, 0.25f);
+                float px = x, py = y;
+                for(int i=1; i<=n; ++i) {
+                    float t  = float(i) / float(n);
+                    float mt = 1.0f - t;
+                    float qx = mt * mt * x + 2.0f * mt * t * cx + t * t * nextX;
+                    float qy = mt * mt * y + 2.0f * mt * t * cy + t * t * nextY;
+                    DrawLine(cells, px, py, qx, qy);
+                    px = qx;
+                    py = qy;
+                }
+                break;
+            }
+
+            case STBTT_vcubic: {
+                float c1x = toX(vertex.cx),  c1y = toY(vertex.cy);
+                float c2x = toX(vertex.cx1), c2y = toY(vertex.cy1);
+                float ddx = std::max(std::fabs(x - 2.0f * c1x + c2x), std::fabs(c1x - 2.0f * c2x + nextX));
+                float ddy = std::max(std::fabs(y - 2.0f * c1y + c2y), std::fabs(c1y - 2.0f * c2y + nextY));
+                int   n   = GetNumSegments(ddx, ddy, 0.75f);
+                float px = x, py = y;
+                for(int i=1; i<=n; ++i) {
+                    float t  = float(i) / float(n);
+                    float mt = 1.0f - t;
+                    float qx = mt * mt * mt * x + 3.0f * mt * mt * t * c1x + 3.0f * mt * t * t * c2x + t * t * t * nextX;
+                    float qy = mt * mt * mt * y + 3.0f * mt * mt * t * c1y + 3.0f * mt * t * t * c2y + t * t * t * nextY;
+                    DrawLine(cells, px, py, qx, qy);
+                    px = qx;
+                    py = qy;
+                }
+                break;
+            }
+        }
+
+        x = nextX;
+        y = nextY;
+    }
+    DrawLine(cells, x, y, startX, startY);
+
+    AccumulateCells(cells.data, count, pixels);
+
+    return true;
+}
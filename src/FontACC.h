@@ -0,0 +1,29 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontSTB.h"
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // stb_truetype parses the font (outlines, metrics, kerning) and the glyphs are rasterized with a signed area
+    // accumulation buffer (font-rs style): each edge adds its coverage deltas to the cells it crosses and a single
+    // prefix sum over the buffer (SSE2 when available) gives the coverage of every pixel.
+    class FontACC : public FontSTB {
+        public:
+            explicit                    FontACC(const char *fontName, FontAllocator *allocator = nullptr);
+            explicit                    FontACC(FontFace *face, AtlasManager *atlas = nullptr, FontAllocator *allocator = nullptr);
+            virtual                     ~FontACC();
+
+        protected:
+            bool                        RenderGlyph(int glyph, uint8_t textHeight, uint8_t *pixels, int32_t width, int32_t height) override;
+    };
+
+} // end of namespace
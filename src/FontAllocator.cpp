@@ -0,0 +1,114 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontAllocator.h"
+//-------------------------------------
+#include <cstdio>
+#include <cstdlib>
+
+using namespace MindShake;
+
+//-------------------------------------
+static HeapAllocator                gHeap;
+static std::atomic<FontAllocator *> gDefault { &gHeap };
+
+//-------------------------------------
+FontAllocator *
+FontAllocator::GetDefault() {
+    return gDefault.load(std::memory_order_acquire);
+}
+
+//-------------------------------------
+void
+FontAllocator::SetDefault(FontAllocator *allocator) {
+    gDefault.store(allocator != nullptr ? allocator : &gHeap, std::memory_order_release);
+}
+
+//-------------------------------------
+FontAllocator *
+FontAllocator::GetHeap() {
+    return &gHeap;
+}
+
+//-------------------------------------
+void *
+HeapAllocator::Allocate(size_t size) {
+    void *memory = malloc(size);
+    if(memory == nullptr)
+        return nullptr;
+
+    size_t used = mUsedBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = mPeakBytes.load(std::memory_order_relaxed);
+    while(peak < used && mPeakBytes.compare_exchange_weak(peak, used, std::memory_order_relaxed) == false) {
+    }
+
+    return memory;
+}
+
+//-------------------------------------
+void
+HeapAllocator::Free(void *memory, size_t size) {
+    if(memory == nullptr)
+        return;
+
+    mUsedBytes.fetch_sub(size, std::memory_order_relaxed);
+    free(memory);
+}
+
+//-------------------------------------
+ArenaAllocator::ArenaAllocator(size_t capacity, FontAllocator *parent) {
+    mParent = parent != nullptr ? parent : FontAllocator::GetHeap();
+    mMemory = static_cast<uint8_t *>(mParent->Allocate(capacity));
+    if(mMemory == nullptr) {
+        fprintf(stderr, "Not enough memory\n");
+        return;
+    }
+    mCapacity = capacity;
+}
+
+//-------------------------------------
+ArenaAllocator::~ArenaAllocator() {
+    if(mMemory != nullptr) {
+        mParent->Free(mMemory, mCapacity);
+    }
+}
+
+//-------------------------------------
+void *
+ArenaAllocator::Allocate(size_t size) {
+    size = (size + 15) & ~size_t(15);
+
+    if(mFrozen) {
+        if(mNumFrozenAllocations++ == 0) {
+            fprintf(stderr, "Allocation of %zu bytes in a frozen arena\n", size);
+        }
+    }
+
+    if(size > mCapacity - mOffset) {
+        ++mNumFailedAllocations;
+        return nullptr;
+    }
+
+    void *memory = mMemory + mOffset;
+    mOffset += size;
+    if(mPeak < mOffset)
+        mPeak = mOffset;
+    ++mNumAllocations;
+
+    return memory;
+}
+
+//-------------------------------------
+void
+ArenaAllocator::Free(void *memory, size_t size) {
+    size = (size + 15) & ~size_t(15);
+
+    // Only the last one
+    if(memory != nullptr && static_cast<uint8_t *>(memory) + size == mMemory + mOffset) {
+        mOffset -= size;
+    }
+}
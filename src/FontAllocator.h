@@ -0,0 +1,143 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Where the fonts, atlases and their containers get their memory from.
+    // Memory is aligned to 16 bytes. Allocate returns nullptr when there is no memory left.
+    class FontAllocator {
+        public:
+            virtual                     ~FontAllocator() = default;
+
+            virtual void *              Allocate(size_t size) = 0;
+            virtual void                Free(void *memory, size_t size) = 0;
+
+            // Used by whatever is not given an allocator: atlases and packers created without one, font collections and
+            // text scenes, and the scratch memory of each thread. Set it before creating them (nullptr is malloc / free).
+            static FontAllocator *      GetDefault();
+            static void                 SetDefault(FontAllocator *allocator);
+            static FontAllocator *      GetHeap();
+    };
+
+    //---------------------------------
+    // malloc / free, counting the bytes in use
+    class HeapAllocator : public FontAllocator {
+        public:
+            void *                      Allocate(size_t size) override;
+            void                        Free(void *memory, size_t size) override;
+
+            size_t                      GetUsedBytes() const                { return mUsedBytes.load(std::memory_order_relaxed);   }
+            size_t                      GetPeakBytes() const                { return mPeakBytes.load(std::memory_order_relaxed);   }
+
+        protected:
+            std::atomic<size_t>     mUsedBytes { 0 };
+            std::atomic<size_t>     mPeakBytes { 0 };
+    };
+
+    //---------------------------------
+    // Bump allocator over a single block, for the "load the fonts, warm the cache, then freeze" pattern.
+    // Free only gives back the last allocation, so leave some room for the containers that grow.
+    // Once frozen every allocation is counted (and the first one reported to stderr): steady state rendering
+    // must not allocate. Not thread safe.
+    class ArenaAllocator : public FontAllocator {
+        public:
+            explicit                    ArenaAllocator(size_t capacity, FontAllocator *parent = nullptr);
+                                        ~ArenaAllocator() override;
+
+                                        ArenaAllocator(const ArenaAllocator &) = delete;
+            ArenaAllocator &            operator = (const ArenaAllocator &) = delete;
+
+            void *                      Allocate(size_t size) override;
+            void                        Free(void *memory, size_t size) override;
+
+            void                        Freeze()                            { mFrozen = true;                           }
+            void                        Unfreeze()                          { mFrozen = false;                          }
+            bool                        IsFrozen() const                    { return mFrozen;                           }
+
+            size_t                      GetCapacity() const                 { return mCapacity;                         }
+            size_t                      GetUsedBytes() const                { return mOffset;                           }
+            size_t                      GetPeakBytes() const                { return mPeak;                             }
+            uint64_t                    GetNumAllocations() const           { return mNumAllocations;                   }
+            uint64_t                    GetNumFrozenAllocations() const     { return mNumFrozenAllocations;             }
+            uint64_t                    GetNumFailedAllocations() const     { return mNumFailedAllocations;             }
+
+        protected:
+            FontAllocator   *mParent {};
+            uint8_t         *mMemory {};
+            size_t          mCapacity {};
+            size_t          mOffset {};
+            size_t          mPeak {};
+            uint64_t        mNumAllocations {};
+            uint64_t        mNumFrozenAllocations {};
+            uint64_t        mNumFailedAllocations {};
+            bool            mFrozen {};
+    };
+
+    //---------------------------------
+    // Standard allocator adapter. Default constructed it takes FontAllocator::GetDefault().
+    template <typename T>
+    class StlAllocator {
+        template <typename U> friend class StlAllocator;
+
+        public:
+            using value_type                             = T;
+            using propagate_on_container_copy_assignment = std::true_type;
+            using propagate_on_container_move_assignment = std::true_type;
+            using propagate_on_container_swap            = std::true_type;
+
+        public:
+                                        StlAllocator() : mAllocator(FontAllocator::GetDefault())                { }
+                                        StlAllocator(FontAllocator *allocator) : mAllocator(allocator != nullptr ? allocator : FontAllocator::GetDefault())  { }
+            template <typename U>       StlAllocator(const StlAllocator<U> &other) : mAllocator(other.mAllocator)  { }
+
+            T *                         allocate(size_t n) {
+                void *memory = mAllocator->Allocate(n * sizeof(T));
+                if(memory == nullptr)
+                    throw std::bad_alloc();
+                return static_cast<T *>(memory);
+            }
+            void                        deallocate(T *memory, size_t n)     { mAllocator->Free(memory, n * sizeof(T));  }
+
+            FontAllocator *             GetAllocator() const                { return mAllocator;                        }
+
+            template <typename U>
+            bool                        operator == (const StlAllocator<U> &other) const    { return mAllocator == other.mAllocator;   }
+            template <typename U>
+            bool                        operator != (const StlAllocator<U> &other) const    { return mAllocator != other.mAllocator;   }
+
+        protected:
+            FontAllocator   *mAllocator;
+    };
+
+    //---------------------------------
+    template <typename T>
+    using FontVector  = std::vector<T, StlAllocator<T>>;
+
+    template <typename Key, typename Value>
+    using FontHashMap = std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>, StlAllocator<std::pair<const Key, Value>>>;
+
+    template <typename Key>
+    using FontHashSet = std::unordered_set<Key, std::hash<Key>, std::equal_to<Key>, StlAllocator<Key>>;
+
+    using FontString  = std::basic_string<char, std::char_traits<char>, StlAllocator<char>>;
+
+} // end of namespace
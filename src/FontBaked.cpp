@@ -0,0 +1,126 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontBaked.h"
+#include "GlyphBlit.h"
+#include "UTF8_Utils.h"
+//-------------------------------------
+#include <algorithm>
+
+using namespace MindShake;
+
+//-------------------------------------
+const BakedGlyph *
+FontBaked::FindGlyph(uint32_t codePoint, uint8_t height) const {
+    if(mData->numGlyphs == 0 || codePoint > 0xffffff)
+        return nullptr;
+
+    uint32_t key          = codePoint | (uint32_t(height) << 24);
+    uint32_t displacement = mData->displacements[BakedHash(key, 0) % mData->numBuckets];
+    const BakedGlyph &glyph = mData->glyphs[BakedHash(key, displacement + 1) % mData->numGlyphs];
+
+    return glyph.key == key ? &glyph : nullptr;
+}
+
+//-------------------------------------
+const BakedHeight *
+FontBaked::FindHeight(uint8_t height) const {
+    for(uint32_t i=0; i<mData->numHeights; ++i) {
+        if(mData->heights[i].height == height)
+            return &mData->heights[i];
+    }
+
+    return nullptr;
+}
+
+//-------------------------------------
+int32_t
+FontBaked::GetKerning(uint32_t codePoint, uint32_t next) const {
+    const BakedKerning *begin = mData->kernings;
+    const BakedKerning *end   = mData->kernings + mData->numKernings;
+    uint64_t           key    = (uint64_t(codePoint) << 32) | next;
+
+    auto it = std::lower_bound(begin, end, key, [](const BakedKerning &kerning, uint64_t key) { return kerning.key < key; });
+
+    return it != end && it->key == key ? it->amount : 0;
+}
+
+//-------------------------------------
+// Same layout as Font::DrawText
+void
+FontBaked::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) const {
+    if(utf8 == nullptr || textHeight == 0)
+        return;
+
+    const BakedHeight *heightData = FindHeight(textHeight);
+    if(heightData == nullptr)
+        return;
+
+    uint32_t codePoint;
+    uint32_t offsetTextX = 0, offsetTextY = 0;
+
+    posY += heightData->ascent; // baseline
+
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            offsetTextY += (heightData->ascent - heightData->descent);
+            continue;
+        }
+
+        const BakedGlyph *glyph = FindGlyph(codePoint, textHeight);
+        if(glyph != nullptr) {
+            BlitAlpha(mData->atlas, mData->atlasWidth, glyph->u, glyph->v, glyph->width, glyph->height, false, posX + glyph->x + offsetTextX, posY + glyph->y + offsetTextY, color, dst, dstStride, mLeft, mTop, mRight, mBottom);
+            offsetTextX += glyph->advanceWidth + uint32_t(GetKerning(codePoint, uint32_t(*utf8)) * heightData->scale);
+        }
+    }
+}
+
+//-------------------------------------
+// Same box as Font::GetTextBox
+void
+FontBaked::GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect) const {
+    if(utf8 == nullptr || textHeight == 0)
+        return;
+
+    const BakedHeight *heightData = FindHeight(textHeight);
+    if(heightData == nullptr)
+        return;
+
+    uint32_t codePoint;
+    int32_t  offsetTextX = 0, offsetTextY = 0;
+    int32_t  minX = 0xffff, maxX = 0;
+    int32_t  minY = 0xffff, maxY = 0;
+
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            offsetTextY += (heightData->ascent - heightData->descent);
+            maxY = 0;
+            continue;
+        }
+
+        const BakedGlyph *glyph = FindGlyph(codePoint, textHeight);
+        if(glyph != nullptr) {
+            int32_t currentY = heightData->ascent + glyph->y + offsetTextY;
+            int32_t currentX = glyph->x + offsetTextX;
+            maxY = std::max(maxY, currentY + int32_t(glyph->height));
+            minY = std::min(minY, currentY);
+            maxX = std::max(maxX, currentX + std::max(int32_t(glyph->width), int32_t(glyph->advanceWidth)));
+            minX = std::min(minX, currentX);
+
+            offsetTextX += glyph->advanceWidth + uint32_t(GetKerning(codePoint, uint32_t(*utf8)) * heightData->scale);
+        }
+    }
+
+    if(pRect != nullptr) {
+        pRect->x      = minX;
+        pRect->y      = minY;
+        pRect->width  = maxX - 1;
+        pRect->height = maxY - 1;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "SkylineBinPack.h"
+//-------------------------------------
+#include <cstdint>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    struct BakedHeight {
+        uint32_t    height;
+        float       scale;
+        int32_t     ascent;
+        int32_t     descent;
+        int32_t     lineGap;
+    };
+
+    //---------------------------------
+    struct BakedGlyph {
+        uint32_t    key;                // codePoint | height << 24
+        int16_t     x, y;               // From the pen position and the baseline
+        int16_t     advanceWidth;
+        uint16_t    u, v;               // In the atlas (never rotated)
+        uint16_t    width, height;
+    };
+
+    //---------------------------------
+    struct BakedKerning {
+        uint64_t    key;                // codePoint << 32 | next (see FontBaked::GetKerning)
+        int32_t     amount;             // Font units
+    };
+
+    //---------------------------------
+    // Written by fontBake as constexpr arrays. The glyphs are a minimal perfect hash table: the bucket of a key
+    // (BakedHash with seed 0) gives the seed of its slot (BakedHash with seed displacement + 1).
+    struct BakedFontData {
+        const uint8_t       *atlas;
+        uint32_t            atlasWidth;
+        uint32_t            atlasHeight;
+        const BakedHeight   *heights;
+        uint32_t            numHeights;
+        const BakedGlyph    *glyphs;
+        uint32_t            numGlyphs;
+        const uint32_t      *displacements;
+        uint32_t            numBuckets;
+        const BakedKerning  *kernings;      // Sorted by key
+        uint32_t            numKernings;
+    };
+
+    //---------------------------------
+    constexpr uint32_t
+    BakedHash(uint32_t key, uint32_t seed) {
+        uint32_t hash = key ^ (seed * 0x9e3779b9u);
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    //---------------------------------
+    // Draws text from a font baked offline (see fontBake): no font file, no rasterizer and no heap.
+    // Same layout and pixels as Font::DrawText / GetTextBox with the settings it was baked with.
+    // Code points or heights not baked are skipped.
+    class FontBaked {
+        public:
+            using Rect = SkylineBinPack::Rect;
+
+        public:
+            explicit                    FontBaked(const BakedFontData &data) : mData(&data)    { }
+
+            void                        DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) const;
+            void                        GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect) const;
+
+            void                        SetClipping(int32_t left, int32_t top, int32_t right, int32_t bottom)   { mLeft = left; mRight = right; mTop = top; mBottom = bottom; }
+            void                        GetClipping(int32_t *left, int32_t *top, int32_t *right, int32_t *bottom) const  { *left = mLeft; *right = mRight; *top = mTop; *bottom = mBottom; }
+
+            const BakedGlyph *          FindGlyph(uint32_t codePoint, uint8_t height) const;
+            const BakedHeight *         FindHeight(uint8_t height) const;
+            // In font units. next is the value Font::DrawText looks ahead (the next byte of the string).
+            int32_t                     GetKerning(uint32_t codePoint, uint32_t next) const;
+
+            const uint8_t *             GetTexture() const                  { return mData->atlas;                      }
+            uint32_t                    GetTextureWidth() const             { return mData->atlasWidth;                 }
+            uint32_t                    GetTextureHeight() const            { return mData->atlasHeight;                }
+            uint32_t                    GetNumGlyphs() const                { return mData->numGlyphs;                  }
+
+        protected:
+            const BakedFontData     *mData;
+
+            int32_t                 mLeft   { -0xffff };
+            int32_t                 mTop    { -0xffff };
+            int32_t                 mRight  {  0xffff };
+            int32_t                 mBottom {  0xffff };
+    };
+
+} // end of namespace
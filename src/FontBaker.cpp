@@ -0,0 +1,254 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontBaker.h"
+#include "UTF8_Utils.h"
+//-------------------------------------
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
+using namespace MindShake;
+
+//-------------------------------------
+static const uint32_t kMaxDisplacement = 1 << 24;
+
+//-------------------------------------
+bool
+FontBaker::Bake(Font &font, const char *utf8, const uint8_t *heights, uint32_t numHeights, uint32_t atlasWidth, uint32_t maxAtlasHeight) {
+    struct Pending {
+        uint32_t            key;
+        CodePointHeightData data;   // In the font atlas
+    };
+
+    std::vector<uint32_t>           codePoints;
+    std::vector<uint32_t>           nextValues;     // What Font::DrawText looks ahead for the kerning
+    std::unordered_set<uint32_t>    seen;
+    std::vector<Pending>            pending;
+    uint32_t                        codePoint;
+
+    mAtlas.clear();
+    mHeights.clear();
+    mGlyphs.clear();
+    mDisplacements.clear();
+    mKernings.clear();
+    mAtlasWidth  = atlasWidth;
+    mAtlasHeight = 0;
+
+    if(utf8 == nullptr || heights == nullptr || font.mStatus < 0)
+        return false;
+
+    // BakedGlyph positions are 16 bits
+    if(atlasWidth == 0 || atlasWidth > 0x10000 || maxAtlasHeight == 0 || maxAtlasHeight > 0x10000) {
+        fprintf(stderr, "Invalid atlas size %u x %u\n", atlasWidth, maxAtlasHeight);
+        return false;
+    }
+
+    font.PreloadGlyphs(utf8, heights, numHeights);
+
+    nextValues.push_back('\n');
+    nextValues.push_back(0);
+    const char *text = utf8;
+    while(true) {
+        uint32_t next = uint32_t(*text);
+        if((codePoint = GetNextUTF32(&text)) == 0)
+            break;
+
+        if(codePoint <= 0xffffff && codePoint != '\n' && seen.insert(codePoint).second) {
+            codePoints.push_back(codePoint);
+            if(std::find(nextValues.begin(), nextValues.end(), next) == nextValues.end()) {
+                nextValues.push_back(next);
+            }
+        }
+    }
+
+    for(uint32_t i=0; i<numHeights; ++i) {
+        uint8_t height = heights[i];
+        if(height == 0 || std::any_of(mHeights.begin(), mHeights.end(), [height](const BakedHeight &baked) { return baked.height == height; }))
+            continue;
+
+        const HeightData &heightData = font.GetDataForHeight(height);
+        mHeights.push_back({ height, heightData.scale, heightData.ascent, heightData.descent, heightData.lineGap });
+
+        for(uint32_t index : codePoints) {
+            const CodePointHeightData &data = font.GetCodePointDataForHeight(index, height);
+            if(data.glyph > 0) {
+                pending.push_back({ index | (uint32_t(height) << 24), data });
+            }
+            else if(font.GetCodePointGlyph(index) != 0) {
+                fprintf(stderr, "Code point %u height %u could not be rendered\n", index, uint32_t(height));
+                return false;
+            }
+        }
+    }
+
+    // Tallest first packs better. Rotated glyphs of the font atlas are stored upright.
+    std::sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) {
+        if(a.data.GetHeight() != b.data.GetHeight())
+            return a.data.GetHeight() > b.data.GetHeight();
+        return a.data.GetWidth() > b.data.GetWidth();
+    });
+
+    SkylineBinPack packer(atlasWidth, maxAtlasHeight, false);
+    mAtlas.assign(size_t(atlasWidth) * maxAtlasHeight, 0);
+    for(const auto &glyph : pending) {
+        const CodePointHeightData &data = glyph.data;
+        int32_t width  = data.GetWidth();
+        int32_t height = data.GetHeight();
+
+        SkylineBinPack::Rect rect = packer.Insert(width, height, SkylineBinPack::ELevelChoiceHeuristic::LevelBottomLeft);
+        if(rect.width <= 0) {
+            fprintf(stderr, "The glyphs do not fit in an atlas of %u x %u\n", atlasWidth, maxAtlasHeight);
+            return false;
+        }
+
+        const uint8_t *texture = font.mAtlas->GetPageTexture(data.page);
+        size_t        stride   = font.mAtlas->GetPageWidth();
+        for(int32_t y=0; y<height; ++y) {
+            for(int32_t x=0; x<width; ++x) {
+                size_t offset = data.rotated ? (data.rect.y + x) * stride + data.rect.x + y : (data.rect.y + y) * stride + data.rect.x + x;
+                mAtlas[(rect.y + y) * size_t(atlasWidth) + rect.x + x] = texture[offset];
+            }
+        }
+
+        mAtlasHeight = std::max(mAtlasHeight, uint32_t(rect.bottom()));
+        mGlyphs.push_back({ glyph.key, int16_t(data.x), int16_t(data.y), int16_t(data.advanceWidth), uint16_t(rect.x), uint16_t(rect.y), uint16_t(width), uint16_t(height) });
+    }
+    mAtlasHeight = std::max(mAtlasHeight, 1u);
+    mAtlas.resize(size_t(atlasWidth) * mAtlasHeight);
+
+    // Pairs with kerning, scaled when drawing
+    for(uint32_t index : codePoints) {
+        uint32_t glyph = font.GetCodePointGlyph(index);
+        if(glyph == 0)
+            continue;
+
+        for(uint32_t next : nextValues) {
+            int32_t amount = font.GetKerning(glyph, font.GetCodePointGlyph(next));
+            if(amount != 0) {
+                mKernings.push_back({ (uint64_t(index) << 32) | next, amount });
+            }
+        }
+    }
+    std::sort(mKernings.begin(), mKernings.end(), [](const BakedKerning &a, const BakedKerning &b) { return a.key < b.key; });
+
+    return BuildHashTable();
+}
+
+//-------------------------------------
+// Hash and displace: the biggest buckets first, each one with the first seed that sends all its keys to free slots
+bool
+FontBaker::BuildHashTable() {
+    uint32_t numKeys    = uint32_t(mGlyphs.size());
+    uint32_t numBuckets = std::max((numKeys + 3) / 4, 1u);
+
+    std::vector<std::vector<uint32_t>>  buckets(numBuckets);
+    std::vector<uint32_t>               order(numBuckets);
+    std::vector<BakedGlyph>             slots(numKeys);
+    std::vector<bool>                   used(numKeys);
+    std::vector<uint32_t>               bucketSlots;
+
+    for(uint32_t i=0; i<numKeys; ++i) {
+        buckets[BakedHash(mGlyphs[i].key, 0) % numBuckets].push_back(i);
+    }
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    mDisplacements.assign(numBuckets, 0);
+    for(uint32_t bucket : order) {
+        if(buckets[bucket].empty())
+            break;
+
+        uint32_t displacement = 0;
+        for(; displacement < kMaxDisplacement; ++displacement) {
+            bucketSlots.clear();
+            for(uint32_t i : buckets[bucket]) {
+                uint32_t slot = BakedHash(mGlyphs[i].key, displacement + 1) % numKeys;
+                if(used[slot] || std::find(bucketSlots.begin(), bucketSlots.end(), slot) != bucketSlots.end())
+                    break;
+                bucketSlots.push_back(slot);
+            }
+            if(bucketSlots.size() == buckets[bucket].size())
+                break;
+        }
+
+        if(displacement == kMaxDisplacement) {
+            fprintf(stderr, "Could not build the glyph hash table\n");
+            return false;
+        }
+
+        mDisplacements[bucket] = displacement;
+        for(size_t i=0; i<bucketSlots.size(); ++i) {
+            used[bucketSlots[i]]  = true;
+            slots[bucketSlots[i]] = mGlyphs[buckets[bucket][i]];
+        }
+    }
+
+    mGlyphs.swap(slots);
+
+    return true;
+}
+
+//-------------------------------------
+bool
+FontBaker::WriteHeader(FILE *file, const char *name, const char *comment) const {
+    if(file == nullptr || name == nullptr)
+        return false;
+
+    fprintf(file, "#pragma once\n\n");
+    fprintf(file, "// Generated by fontBake%s%s. Do not edit.\n", comment != nullptr ? ": " : "", comment != nullptr ? comment : "");
+    fprintf(file, "// %u glyphs, %u kerning pairs, atlas of %u x %u\n\n", GetNumGlyphs(), GetNumKernings(), mAtlasWidth, mAtlasHeight);
+    fprintf(file, "#include <FontBaked.h>\n\n");
+
+    // Empty arrays are not allowed: one zeroed entry
+    fprintf(file, "//-------------------------------------\n");
+    fprintf(file, "static constexpr uint8_t k%sAtlas[%u * %u] = {", name, mAtlasWidth, mAtlasHeight);
+    for(size_t i=0; i<mAtlas.size(); ++i) {
+        fprintf(file, "%s0x%02x,", i % 32 == 0 ? "\n    " : "", mAtlas[i]);
+    }
+    fprintf(file, "\n};\n\n");
+
+    fprintf(file, "static constexpr MindShake::BakedHeight k%sHeights[] = {\n", name);
+    for(const auto &height : mHeights) {
+        fprintf(file, "    { %u, %.9ef, %d, %d, %d },\n", height.height, height.scale, height.ascent, height.descent, height.lineGap);
+    }
+    if(mHeights.empty())
+        fprintf(file, "    { },\n");
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "static constexpr MindShake::BakedGlyph k%sGlyphs[] = {\n", name);
+    for(const auto &glyph : mGlyphs) {
+        fprintf(file, "    { 0x%08xu, %d, %d, %d, %u, %u, %u, %u },\n", glyph.key, glyph.x, glyph.y, glyph.advanceWidth, glyph.u, glyph.v, glyph.width, glyph.height);
+    }
+    if(mGlyphs.empty())
+        fprintf(file, "    { },\n");
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "static constexpr uint32_t k%sDisplacements[] = {", name);
+    for(size_t i=0; i<mDisplacements.size(); ++i) {
+        fprintf(file, "%s%u,", i % 16 == 0 ? "\n    " : " ", mDisplacements[i]);
+    }
+    fprintf(file, "\n};\n\n");
+
+    fprintf(file, "static constexpr MindShake::BakedKerning k%sKernings[] = {\n", name);
+    for(const auto &kerning : mKernings) {
+        fprintf(file, "    { 0x%016llxull, %d },\n", (unsigned long long) kerning.key, kerning.amount);
+    }
+    if(mKernings.empty())
+        fprintf(file, "    { },\n");
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "static constexpr MindShake::BakedFontData k%sFont = {\n", name);
+    fprintf(file, "    k%sAtlas, %u, %u,\n", name, mAtlasWidth, mAtlasHeight);
+    fprintf(file, "    k%sHeights, %u,\n", name, uint32_t(mHeights.size()));
+    fprintf(file, "    k%sGlyphs, %u,\n", name, uint32_t(mGlyphs.size()));
+    fprintf(file, "    k%sDisplacements, %u,\n", name, uint32_t(mDisplacements.size()));
+    fprintf(file, "    k%sKernings, %u,\n", name, uint32_t(mKernings.size()));
+    fprintf(file, "};\n");
+
+    return ferror(file) == 0;
+}
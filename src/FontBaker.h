@@ -0,0 +1,48 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "Font.h"
+#include "FontBaked.h"
+//-------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Offline side of FontBaked: renders the code points of utf8 at every height with the font (and its
+    // current antialias settings), packs them in a single atlas and writes a C++ header with the data.
+    class FontBaker {
+        public:
+            // Atlas of atlasWidth x up to maxAtlasHeight
+            bool                        Bake(Font &font, const char *utf8, const uint8_t *heights, uint32_t numHeights, uint32_t atlasWidth = 512, uint32_t maxAtlasHeight = 4096);
+            // constexpr arrays named k<name>Atlas, k<name>Glyphs... and the BakedFontData k<name>Font
+            bool                        WriteHeader(FILE *file, const char *name, const char *comment) const;
+
+            uint32_t                    GetNumGlyphs() const                { return uint32_t(mGlyphs.size());          }
+            uint32_t                    GetNumKernings() const              { return uint32_t(mKernings.size());        }
+            uint32_t                    GetAtlasWidth() const               { return mAtlasWidth;                       }
+            uint32_t                    GetAtlasHeight() const              { return mAtlasHeight;                      }
+
+        protected:
+            bool                        BuildHashTable();
+
+        protected:
+            std::vector<uint8_t>        mAtlas;
+            uint32_t                    mAtlasWidth {};
+            uint32_t                    mAtlasHeight {};
+            std::vector<BakedHeight>    mHeights;
+            std::vector<BakedGlyph>     mGlyphs;            // By slot once baked
+            std::vector<uint32_t>       mDisplacements;
+            std::vector<BakedKerning>   mKernings;
+    };
+
+} // end of namespace
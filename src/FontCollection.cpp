@@ -0,0 +1,199 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontCollection.h"
+#include "FontTrace.h"
+#include "UTF8_Utils.h"
+//-------------------------------------
+#include <algorithm>
+
+using namespace MindShake;
+
+//-------------------------------------
+FontCollection::FontCollection(AtlasManager *atlas) {
+    mAtlas = atlas;
+    if(mAtlas == nullptr) {
+        if(mOwnAtlas.Init(512, 0x8000, 128) == false) {
+            mStatus = -5;
+            return;
+        }
+        mAtlas = &mOwnAtlas;
+    }
+
+    mStatus = 1;
+}
+
+//-------------------------------------
+FontCollection::~FontCollection() {
+    // Give the fonts back their own atlas
+    for(auto *font : mFonts) {
+        font->SetAtlas(nullptr);
+    }
+}
+
+//-------------------------------------
+bool
+FontCollection::AddFont(Font *font) {
+    if(font == nullptr || font->mStatus < 0 || mStatus < 0)
+        return false;
+
+    font->SetAtlas(mAtlas);
+    mFonts.push_back(font);
+
+    // Code points that were missing could be in the new font
+    for(auto it = mCodePointFont.begin(); it != mCodePointFont.end(); ) {
+        if(it->second < 0)
+            it = mCodePointFont.erase(it);
+        else
+            ++it;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+void
+FontCollection::Reset() {
+    for(auto *font : mFonts) {
+        font->Reset();
+    }
+
+    mCodePointFont.clear();
+}
+
+//-------------------------------------
+int32_t
+FontCollection::ResolveFont(uint32_t codePoint) {
+    auto it = mCodePointFont.find(codePoint);
+    if(it != mCodePointFont.end())
+        return it->second;
+
+    int32_t fontIndex = -1;
+    for(size_t i = 0; i < mFonts.size(); ++i) {
+        if(mFonts[i]->GetCodePointData(codePoint).glyph != 0) {
+            fontIndex = int32_t(i);
+            break;
+        }
+    }
+    mCodePointFont[codePoint] = fontIndex;
+
+    return fontIndex;
+}
+
+//-------------------------------------
+// Same layout as Font::DrawText
+void
+FontCollection::DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) {
+    if(utf8 == nullptr || textHeight == 0 || mFonts.empty() || mStatus < 0)
+        return;
+
+    uint32_t codePoint;
+    int32_t  fontIndex;
+    int32_t  offsetTextX, offsetTextY;
+
+    Color32 fontColor = *reinterpret_cast<Color32 *>(&color);
+
+    const HeightData &heightData = mFonts[0]->GetDataForHeight(textHeight);
+
+    posY += heightData.ascent; // baseline
+
+    FONT_TRACE_SCOPE("DrawText");
+    offsetTextX = 0;
+    offsetTextY = 0;
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            offsetTextY += (heightData.ascent - heightData.descent);
+            continue;
+        }
+
+        fontIndex = ResolveFont(codePoint);
+        if(fontIndex < 0)
+            continue;
+
+        const CodePointHeightData &data = mFonts[fontIndex]->GetCodePointDataForHeight(codePoint, textHeight);
+        if(data.glyph > 0) {
+            Font *font = mFonts[fontIndex];
+            font->CountBlit(Font::BlitGlyph(font->mAtlas->GetPageTexture(data.page), font->mAtlas->GetPageWidth(), data.rect, data.rotated, posX + data.x + offsetTextX, posY + data.y + offsetTextY, fontColor, dst, dstStride, mLeft, mTop, mRight, mBottom));
+            offsetTextX += data.advanceWidth + GetKerning(fontIndex, data.glyph, *utf8, textHeight);
+        }
+    }
+}
+
+//-------------------------------------
+// Same box as Font::GetTextBox
+void
+FontCollection::GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect) {
+    if(utf8 == nullptr || textHeight == 0 || mFonts.empty() || mStatus < 0)
+        return;
+
+    uint32_t codePoint;
+    int32_t  fontIndex;
+    int32_t  offsetTextX, offsetTextY;
+    int32_t  currentX, currentY;
+    int32_t  right, bottom;
+    int32_t  minX, maxX;
+    int32_t  minY, maxY;
+
+    const HeightData &heightData = mFonts[0]->GetDataForHeight(textHeight);
+
+    minX = minY = 0xffff;
+    maxX = maxY = 0;
+    offsetTextX = 0;
+    offsetTextY = 0;
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            offsetTextY += (heightData.ascent - heightData.descent);
+            maxY = 0;
+            continue;
+        }
+
+        fontIndex = ResolveFont(codePoint);
+        if(fontIndex < 0)
+            continue;
+
+        // Measured without rasterizing
+        const GlyphMetrics &data = mFonts[fontIndex]->GetGlyphMetrics(codePoint, textHeight);
+        if(data.glyph > 0) {
+            currentY = heightData.ascent + data.y + offsetTextY;
+            bottom = data.height;
+            if(maxY < currentY + bottom)
+                maxY = currentY + bottom;
+            if(minY > currentY)
+                minY = currentY;
+
+            currentX = data.x + offsetTextX;
+            right = std::max(data.width, data.advanceWidth);
+            if(maxX < currentX + right)
+                maxX = currentX + right;
+            if(minX > currentX)
+                minX = currentX;
+
+            offsetTextX += data.advanceWidth + GetKerning(fontIndex, data.glyph, *utf8, textHeight);
+        }
+    }
+
+    if(pRect != nullptr) {
+        pRect->x      = minX;
+        pRect->y      = minY;
+        pRect->width  = maxX - 1;
+        pRect->height = maxY - 1;
+    }
+}
+
+//-------------------------------------
+int32_t
+FontCollection::GetKerning(int32_t fontIndex, int32_t glyph, char next, uint8_t height) {
+    Font *font = mFonts[fontIndex];
+
+    int32_t nextGlyph = font->GetCodePointGlyph(next);
+    if(nextGlyph == 0 || ResolveFont(uint8_t(next)) != fontIndex)
+        return 0;
+
+    return int32_t(font->GetKerning(glyph, nextGlyph) * font->GetScaleForHeight(height));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "Font.h"
+//-------------------------------------
+#include <cstdint>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Ordered fallback list of fonts.
+    // Each code point is drawn with the first font that has it. All the members
+    // pack their glyphs in the same atlas, so a mixed run is a single pass.
+    // The first font added gives the line metrics (baseline and line height).
+    class FontCollection {
+        protected:
+            using MapCodePointFont       = FontHashMap<uint32_t, int32_t>;
+            using Rect                   = SkylineBinPack::Rect;
+
+        public:
+            // Without an atlas the collection uses its own one
+            explicit                    FontCollection(AtlasManager *atlas = nullptr);
+                                        ~FontCollection();
+
+            // Fonts are not owned and must outlive the collection. They are moved to the collection atlas.
+            bool                        AddFont(Font *font);
+            size_t                      GetNumFonts() const                 { return mFonts.size();                     }
+            Font *                      GetFont(size_t index) const         { return mFonts[index];                     }
+
+            uint8_t                     GetStatus() const                   { return mStatus;                           }
+            void                        Reset();                            // Remove all rendered glyphs and the code point resolution
+
+            // Index of the font used for the code point or -1 if no font has it
+            int32_t                     ResolveFont(uint32_t codePoint);
+
+            AtlasManager *              GetAtlas() const                    { return mAtlas;                            }
+
+            void                        DrawText(const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY);
+            void                        GetTextBox(const char *utf8, uint8_t textHeight, Rect *pRect);
+
+            void                        SetClipping(int32_t left, int32_t top, int32_t right, int32_t bottom)   { mLeft = left; mRight = right; mTop = top; mBottom = bottom; }
+            void                        GetClipping(int32_t *left, int32_t *top, int32_t *right, int32_t *bottom) const  { *left = mLeft; *right = mRight; *top = mTop; *bottom = mBottom; }
+
+        protected:
+            // Same rule as Font: with the glyph of the next byte, if that one is drawn with the same font
+            int32_t                     GetKerning(int32_t fontIndex, int32_t glyph, char next, uint8_t height);
+
+        protected:
+            FontVector<Font *>      mFonts;
+            AtlasManager            mOwnAtlas;
+            AtlasManager            *mAtlas {};
+            MapCodePointFont        mCodePointFont;
+
+            int32_t                 mLeft   { -0xffff };
+            int32_t                 mTop    { -0xffff };
+            int32_t                 mRight  {  0xffff };
+            int32_t                 mBottom {  0xffff };
+
+            int8_t                  mStatus { -1 };
+    };
+
+} // end of namespace
@@ -0,0 +1,183 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontFace.h"
+//-------------------------------------
+#include <cstdio>
+
+using namespace MindShake;
+
+//-------------------------------------
+FontFace *
+FontFace::Load(const char *fontName, FontAllocator *allocator) {
+    if(allocator == nullptr)
+        allocator = FontAllocator::GetDefault();
+
+    void *memory = allocator->Allocate(sizeof(FontFace));
+    if(memory == nullptr) {
+        fprintf(stderr, "Not enough memory\n");
+        return nullptr;
+    }
+
+    FontFace *face = new (memory) FontFace(fontName, allocator);
+    if(face->LoadFontFile() == false)
+        return face;
+
+    // Both backends only read the file from now on. Finding the tables is cheap (stb_truetype doesn't allocate):
+    // libschrift is only loaded here if stb_truetype can't parse the font.
+    bool parsedSTB = face->ParseSTB();
+    if(parsedSTB == false && face->GetSFTFont() == nullptr) {
+        fprintf(stderr, "Init font failed\n");
+        face->mStatus = -4;
+        return face;
+    }
+
+    // The same hhea values stb_truetype gives
+    if(parsedSTB == false) {
+        SFT sft {};
+        sft.xScale = sft_unitsPerEm(face->mSFTFont);
+        sft.yScale = sft.xScale;
+        sft.flags  = SFT_DOWNWARD_Y;
+        sft.font   = face->mSFTFont;
+        SFT_LMetrics metrics {};
+        sft_lmetrics(&sft, &metrics);
+
+        face->mAscent  = int(metrics.ascender);
+        face->mDescent = int(metrics.descender);
+        face->mLineGap = int(metrics.lineGap);
+    }
+
+    face->mStatus = 1;
+
+    return face;
+}
+
+//-------------------------------------
+FontFace::FontFace(const char *fontName, FontAllocator *allocator)
+    : mAllocator(allocator)
+    , mFontName(fontName, FontString::allocator_type(allocator))
+    , mKerning(MapKerning::allocator_type(allocator))
+    , mSFTKerning(MapKerning::allocator_type(allocator)) {
+}
+
+//-------------------------------------
+FontFace::~FontFace() {
+    if(mSFTFont != nullptr) {
+        sft_freefont(mSFTFont);
+        mSFTFont = nullptr;
+    }
+
+    if(mData != nullptr) {
+        mAllocator->Free(mData, mDataSize);
+        mData = nullptr;
+    }
+}
+
+//-------------------------------------
+void
+FontFace::Release() {
+    if(mRefs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    FontAllocator *allocator = mAllocator;
+    this->~FontFace();
+    allocator->Free(this, sizeof(FontFace));
+}
+
+//-------------------------------------
+SFT_Font *
+FontFace::GetSFTFont() {
+    // libschrift only allocates its SFT_Font
+    std::call_once(mSFTOnce, [this]() {
+        if(mData != nullptr) {
+            mSFTFont = sft_loadmem(mData, mDataSize);
+        }
+    });
+
+    return mSFTFont;
+}
+
+//-------------------------------------
+const FontFace::MapKerning &
+FontFace::GetKerning() {
+    std::call_once(mKerningOnce, [this]() {
+        if(mInfo.data != nullptr) {
+            ReadKerningSTB();
+        }
+    });
+
+    return mKerning;
+}
+
+//-------------------------------------
+// Fonts of the face on different threads share the cache: lookups lock it, libschrift runs outside the lock
+int32_t
+FontFace::GetSFTKerning(uint32_t glyph1, uint32_t glyph2, bool *pCached) {
+    uint64_t key = (uint64_t(glyph1) << 32) | uint64_t(glyph2);
+
+    {
+        std::lock_guard<std::mutex> lock(mSFTKerningMutex);
+        auto it = mSFTKerning.find(key);
+        if(it != mSFTKerning.end()) {
+            *pCached = true;
+            return it->second;
+        }
+    }
+    *pCached = false;
+
+    SFT_Font *font = GetSFTFont();
+    if(font == nullptr)
+        return 0;
+
+    SFT sft {};
+    sft.xScale = sft_unitsPerEm(font);
+    sft.yScale = sft.xScale;
+    sft.font   = font;
+    sft.flags  = SFT_DOWNWARD_Y;
+    SFT_Kerning kerning {};
+    sft_kerning(&sft, glyph1, glyph2, &kerning);
+
+    std::lock_guard<std::mutex> lock(mSFTKerningMutex);
+    mSFTKerning[key] = int32_t(kerning.xShift);
+
+    return int32_t(kerning.xShift);
+}
+
+//-------------------------------------
+// Reads the font file into memory of the allocator
+bool
+FontFace::LoadFontFile() {
+    FILE *fontFile = fopen(mFontName.c_str(), "rb");
+    if(fontFile == nullptr) {
+        fprintf(stderr, "Cannot open file: '%s'.\n", mFontName.c_str());
+        mStatus = -2;
+        return false;
+    }
+
+    fseek(fontFile, 0, SEEK_END);
+    long size = ftell(fontFile);
+    fseek(fontFile, 0, SEEK_SET);
+
+    mData = size > 0 ? static_cast<uint8_t *>(mAllocator->Allocate(size_t(size))) : nullptr;
+    if(mData == nullptr) {
+        fprintf(stderr, "Not enough memory\n");
+        mStatus = -3;
+        fclose(fontFile);
+        return false;
+    }
+    mDataSize = size_t(size);
+
+    if(fread(mData, mDataSize, 1, fontFile) != 1) {
+        fprintf(stderr, "Cannot read file: '%s'.\n", mFontName.c_str());
+        mStatus = -2;
+        fclose(fontFile);
+        return false;
+    }
+    fclose(fontFile);
+
+    return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontAllocator.h"
+//-------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <libschrift/schrift.h>
+#include <stb/stb_truetype.h>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // What every font made from the same file shares and never changes: the file in memory, its tables parsed by each
+    // backend (stb_truetype and libschrift), the vertical metrics and the kerning pairs of the kern table.
+    // Loaded once, the fonts made from it (FontSTB, FontSFT, FontACC) are cheap handles with their own caches,
+    // clipping and settings, e.g. one per thread or per clip rect, each with its own atlas or sharing one.
+    // Reference counted: Load returns it with one reference and each font adds its own, so it can be released
+    // right after creating the fonts. The fonts of a face can be used from different threads (each from one at a time).
+    // Load only reads the file and finds its tables: what each backend needs (the kern table for stb_truetype,
+    // the SFT_Font and its kerning pairs for libschrift) is loaded on first use by that backend, from the allocator
+    // of the face (which must then be thread safe if fonts of the face are used from different threads).
+    class FontFace {
+        public:
+            using MapKerning = FontHashMap<uint64_t, int32_t>;
+
+        public:
+            // The face and its data come from the allocator (nullptr: FontAllocator::GetDefault()), which must outlive it.
+            // Returns nullptr only without memory for the face itself: check GetStatus.
+            static FontFace *           Load(const char *fontName, FontAllocator *allocator = nullptr);
+
+                                        FontFace(const FontFace &) = delete;
+            FontFace &                  operator = (const FontFace &) = delete;
+
+            void                        AddRef()                            { mRefs.fetch_add(1, std::memory_order_relaxed);   }
+            void                        Release();
+
+            // 1: ok, -2: can't read the file, -3: no memory, -4: no backend can parse it
+            int8_t                      GetStatus() const                   { return mStatus;                           }
+            const FontString &          GetFontName() const                 { return mFontName;                         }
+            FontAllocator *             GetAllocator() const                { return mAllocator;                        }
+            const uint8_t *             GetData() const                     { return mData;                             }
+            size_t                      GetDataSize() const                 { return mDataSize;                         }
+
+            // Parsed tables of each backend (nullptr if it can't parse the font). The SFT_Font is loaded on first call.
+            const stbtt_fontinfo *      GetInfo() const                     { return mInfo.data != nullptr ? &mInfo : nullptr;  }
+            SFT_Font *                  GetSFTFont();
+
+            // Font units
+            int                         GetAscent() const                   { return mAscent;                           }
+            int                         GetDescent() const                  { return mDescent;                          }
+            int                         GetLineGap() const                  { return mLineGap;                          }
+            // Glyph pairs (glyph1 << 32 | glyph2) of the kern table, read by stb_truetype on first call
+            const MapKerning &          GetKerning();
+            // Kerning of a glyph pair given by libschrift (font units), cached for every font of the face.
+            // pCached: whether it was already looked up.
+            int32_t                     GetSFTKerning(uint32_t glyph1, uint32_t glyph2, bool *pCached);
+
+        protected:
+            explicit                    FontFace(const char *fontName, FontAllocator *allocator);
+                                        ~FontFace();
+
+            bool                        LoadFontFile();
+            // In FontSTB.cpp, with the stb_truetype implementation
+            bool                        ParseSTB();         // Finds the tables and reads the vertical metrics
+            void                        ReadKerningSTB();
+
+        protected:
+            std::atomic<int32_t>    mRefs { 1 };
+            FontAllocator           *mAllocator {};
+            FontString              mFontName;
+            uint8_t                 *mData {};          // Whole font file
+            size_t                  mDataSize {};
+            stbtt_fontinfo          mInfo {};
+            SFT_Font                *mSFTFont {};
+            int                     mAscent  {};
+            int                     mDescent {};
+            int                     mLineGap {};
+            MapKerning              mKerning;
+            std::once_flag          mKerningOnce;
+            std::once_flag          mSFTOnce;
+            std::mutex              mSFTKerningMutex;
+            MapKerning              mSFTKerning;        // Pairs looked up by libschrift
+            int8_t                  mStatus { -1 };
+    };
+
+} // end of namespace
@@ -17,18 +17,21 @@ namespace MindShake {
     //---------------------------------
     class FontSFT : public Font {
         public:
-            explicit                    FontSFT(const char *fontName);
+            explicit                    FontSFT(const char *fontName, FontAllocator *allocator = nullptr);
+            // A cheap handle over the face, packing its glyphs in the given atlas (nullptr: its own one)
+            explicit                    FontSFT(FontFace *face, AtlasManager *atlas = nullptr, FontAllocator *allocator = nullptr);
             virtual                     ~FontSFT();
 
         protected:
-            void                        GetFontVMetrics();
+            void                        Init(AtlasManager *atlas);
             int                         GetKerning(uint32_t char1, uint32_t char2) override;
 
             const CodePointData &       GetCodePointData(uint32_t index) override;
-            const CodePointHeightData & GetCodePointDataForHeight(uint32_t index, uint8_t height) override;
+            bool                        GetGlyphBox(const CodePointData &codePoint, uint8_t height, CodePointHeightData *pData, int32_t *pWidth, int32_t *pHeight) override;
+            bool                        RenderGlyph(int glyph, uint8_t textHeight, uint8_t *pixels, int32_t width, int32_t height) override;
 
         protected:
-            SFT_Font    *mFont {};
+            SFT_Font    *mFont {};             // Of the face
     };
 
 } // end of namespace
\ No newline at end of file
@@ -5,89 +5,117 @@
 // See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
 //-----------------------------------------------------------------------------
 
+#include "ScratchArena.h"
+
+// stb_truetype temporary buffers come from the scratch arena of the thread (freed by the ScratchScope)
+#define STBTT_malloc(x, u)  ((void) (u), MindShake::ScratchArena::GetThreadArena().Allocate(x))
+#define STBTT_free(x, u)    ((void) (u), (void) (x))
+
 #define STBTT_STATIC
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "FontSTB.h"
+#include "FontTrace.h"
 //-------------------------------------
 #include <cstdio>
-#include <memory>
 
 using namespace MindShake;
 
 //-------------------------------------
-FontSTB::FontSTB(const char *fontName) : Font(fontName) {
-    uint32_t    size;
-
-    // Read font into memory
-    FILE *fontFile = fopen(fontName, "rb");
-    if(fontFile == nullptr) {
-        fprintf(stderr, "Cannot open file: '%s'.\n", fontName);
-        mStatus = -2;
-        return;
-    }
+FontSTB::FontSTB(const char *fontName, FontAllocator *allocator) : Font(fontName, allocator), mOutlines(MapOutlines::allocator_type(mAllocator)) {
+    Init(nullptr);
+}
 
-    fseek(fontFile, 0, SEEK_END);
-    size = ftell(fontFile);
-    fseek(fontFile, 0, SEEK_SET);
+//-------------------------------------
+FontSTB::FontSTB(FontFace *face, AtlasManager *atlas, FontAllocator *allocator) : Font(face, allocator), mOutlines(MapOutlines::allocator_type(mAllocator)) {
+    Init(atlas);
+}
 
-    mFontBuffer = (uint8_t *) malloc(size);
-    if(mFontBuffer == nullptr) {
-        fprintf(stderr, "Not enough memory\n");
-        mStatus = -3;
-        fclose(fontFile);
-        return;
-    }
+//-------------------------------------
+FontSTB::~FontSTB() {
+}
 
-    fread(mFontBuffer, size, 1, fontFile);
-    fclose(fontFile);
-    fontFile = nullptr;
+//-------------------------------------
+void
+FontSTB::Init(AtlasManager *atlas) {
+    if(InitFace() == false)
+        return;
 
-    // Init Font
-    if (!stbtt_InitFont(&mInfo, mFontBuffer, stbtt_GetFontOffsetForIndex(mFontBuffer, 0))) {
+    if(mFace->GetInfo() == nullptr) {
         fprintf(stderr, "Init font failed\n");
         mStatus = -4;
         return;
     }
+    mInfo    = *mFace->GetInfo();
+    mKerning = &mFace->GetKerning();
 
-    if(InitPacker() == false) {
-        mStatus = -5;
+    if(InitPacker(atlas) == false)
         return;
-    }
-
-    stbtt_GetFontVMetrics(&mInfo, &mAscent, &mDescent, &mLineGap);
-
-    GetKerningTable();
 
     mStatus = 1;
 }
 
 //-------------------------------------
-FontSTB::~FontSTB() {
-    if(mFontBuffer != nullptr) {
-        free(mFontBuffer);
-        mFontBuffer = nullptr;
+// The stb_truetype part of FontFace::Load: the implementation is static in this file
+bool
+FontFace::ParseSTB() {
+    if (!stbtt_InitFont(&mInfo, mData, stbtt_GetFontOffsetForIndex(mData, 0))) {
+        mInfo = {};
+        return false;
     }
 
-    if(mTexture != nullptr) {
-        free(mTexture);
-        mTexture = nullptr;
-    }
+    stbtt_GetFontVMetrics(&mInfo, &mAscent, &mDescent, &mLineGap);
+
+    return true;
 }
 
 //-------------------------------------
+// Kerning table (on first use by a FontSTB)
 void
-FontSTB::GetKerningTable() {
+FontFace::ReadKerningSTB() {
     int length = stbtt_GetKerningTableLength(&mInfo);
     if (length > 0) {
-        stbtt_kerningentry *kernings = new stbtt_kerningentry[length];
+        size_t             size     = sizeof(stbtt_kerningentry) * size_t(length);
+        stbtt_kerningentry *kernings = static_cast<stbtt_kerningentry *>(mAllocator->Allocate(size));
+        if(kernings == nullptr)
+            return;
+
         stbtt_GetKerningTable(&mInfo, kernings, length);
-        mKerningData.reserve(size_t(length));
+        mKerning.reserve(size_t(length));
         for (int k = 0; k < length; ++k) {
             auto &current = kernings[k];
-            mKerningData[(uint64_t(current.glyph1) << 32) | uint64_t(current.glyph2)] = current.advance;
+            mKerning[(uint64_t(current.glyph1) << 32) | uint64_t(current.glyph2)] = current.advance;
         }
-        delete[] kernings;
+        mAllocator->Free(kernings, size);
+    }
+}
+
+//-------------------------------------
+const FontSTB::Outline &
+FontSTB::GetGlyphOutline(int glyph) {
+    auto it = mOutlines.find(glyph);
+    if(it == mOutlines.end()) {
+        ScratchScope scratch;
+
+        stbtt_vertex *vertices = nullptr;
+        int numVertices = stbtt_GetGlyphShape(&mInfo, glyph, &vertices);
+        if(vertices == nullptr || numVertices < 0)
+            numVertices = 0;
+
+        it = mOutlines.emplace(glyph, Outline(vertices, vertices + numVertices, Outline::allocator_type(mAllocator))).first;
     }
+
+    return it->second;
+}
+
+//-------------------------------------
+void
+FontSTB::GetGlyphOrigin(int glyph, uint8_t height, int32_t *pX, int32_t *pY) {
+    float scale = GetScaleForHeight(height);
+    int   x0, y0;
+
+    stbtt_GetGlyphBitmapBox(&mInfo, glyph, scale, scale, &x0, &y0, nullptr, nullptr);
+    *pX = x0;
+    *pY = y0;
 }
 
 //-------------------------------------
@@ -117,110 +145,56 @@ FontSTB::GetCodePointData(uint32_t index) {
 }
 
 //-------------------------------------
-const CodePointHeightData &
-FontSTB::GetCodePointDataForHeight(uint32_t index, uint8_t height) {
-    if(mStatus < 0)
-        return mCodePointHeightData[0];
-
-    CodePointHeight cph;
-    cph.codePoint = index;
-    cph.height    = height;
-
-    auto cphd = mCodePointHeightData.find(cph.value);
-    if(cphd == mCodePointHeightData.end()) {
-        const CodePointData &codePoint = GetCodePointData(index);
-        if(codePoint.glyph == 0) {
-            return mCodePointHeightData[0];
-        }
+bool
+FontSTB::GetGlyphBox(const CodePointData &codePoint, uint8_t height, CodePointHeightData *pData, int32_t *pWidth, int32_t *pHeight) {
+    float scale = GetScaleForHeight(height);
+    int x1, y1, x2, y2;
 
-        float scale = GetScaleForHeight(height);
-        int x1, y1, x2, y2;
+    stbtt_GetGlyphBitmapBox(&mInfo, codePoint.glyph, scale, scale, &x1, &y1, &x2, &y2);
 
-        stbtt_GetGlyphBitmapBox(&mInfo, codePoint.glyph, scale, scale, &x1, &y1, &x2, &y2);
+    pData->x               = x1;
+    pData->y               = y1;
+    pData->leftSideBearing = int(floor(codePoint.leftSideBearing * scale));
+    pData->advanceWidth    = int(ceil( codePoint.advanceWidth    * scale));
 
-        int w = (x2 - x1);
-        int h = (y2 - y1);
+    *pWidth  = x2 - x1;
+    *pHeight = y2 - y1;
 
-        // special case (' ')
-        bool isEmpty = false;
-        if(w == 0) {
-            w = 1;
-            isEmpty = true;
-        }
-        if(h == 0) {
-            h = 1;
-            isEmpty = true;
-        }
-
-        auto pixels = std::make_unique<uint8_t[]>(w * h);
-        if(isEmpty) {
-            int offset = 0;
-            for(int y=0; y<h; ++y) {
-                for(int x=0; x<w; ++x) {
-                    pixels[offset + x] = 0;
-                }
-                offset += mPacker.GetWidth();
-            }
-        }
-        else {
-            stbtt_MakeGlyphBitmap(&mInfo, pixels.get(), w, h, w, scale, scale, codePoint.glyph);
-
-            if(mUseAntialias) {
-                if(mAntialiasAllowEx) {
-                    auto dst = std::make_unique<uint8_t[]>((w + 2) * (h + 2));
-                    AABlockEx(pixels.get(), w, h, dst.get(), w + 2);
-                    std::swap(pixels, dst);
-                    w += 2;
-                    h += 2;
-                }
-                else {
-                    auto dst = std::make_unique<uint8_t[]>(w * h);
-                    AABlock(pixels.get(), w, h, dst.get(), w);
-                    std::swap(pixels, dst);
-                }
-            }
-        }
-
-        CodePointHeightData codePointHeight;
-        codePointHeight.glyph           = codePoint.glyph;
-        codePointHeight.x               = x1;
-        codePointHeight.y               = y1;
-        codePointHeight.leftSideBearing = int(floor(codePoint.leftSideBearing * scale));
-        codePointHeight.advanceWidth    = int(ceil( codePoint.advanceWidth    * scale));
-
-        codePointHeight.rect = mPacker.Insert(w, h, ELevelChoiceHeuristic::LevelBottomLeft);
-        if(codePointHeight.rect.width <= 0) {
-            mPacker.ResizeBin(mPacker.GetWidth(), mPacker.GetHeight() << 1);
-            uint8_t *aux = (uint8_t *) realloc(mTexture, mPacker.GetWidth() * mPacker.GetHeight());
-            if(aux == nullptr) {
-                return mCodePointHeightData[0];
-            }
-            mTexture = aux;
-            codePointHeight.rect = mPacker.Insert(w, h, ELevelChoiceHeuristic::LevelBottomLeft);
-            if(codePointHeight.rect.width <= 0) {
-                return mCodePointHeightData[0];
-            }
-        }
-
-        size_t byteOffset   = (codePointHeight.rect.y) * mPacker.GetWidth() + codePointHeight.rect.x;
-        size_t pixelsOffset = 0;
-        for(int y=0; y<h; ++y) {
-            memcpy(&mTexture[byteOffset], &pixels[pixelsOffset], w);
-            byteOffset   += mPacker.GetWidth();
-            pixelsOffset += w;
-        }
+    return true;
+}
 
-        cphd = mCodePointHeightData.insert({cph.value, codePointHeight}).first;
+//-------------------------------------
+bool
+FontSTB::RenderGlyph(int glyph, uint8_t textHeight, uint8_t *pixels, int32_t width, int32_t height) {
+    // stbtt_MakeGlyphBitmap with the cached outline
+    const Outline &outline = GetGlyphOutline(glyph);
+
+    FONT_TRACE_SCOPE("stbtt_Rasterize", "glyph", glyph, "height", textHeight);
+
+    float scale = GetScaleForHeight(textHeight);
+    int   x0, y0;
+    stbtt_GetGlyphBitmapBox(&mInfo, glyph, scale, scale, &x0, &y0, nullptr, nullptr);
+
+    stbtt__bitmap bitmap;
+    bitmap.w      = width;
+    bitmap.h      = height;
+    bitmap.stride = width;
+    bitmap.pixels = pixels;
+
+    if(width != 0 && height != 0 && outline.empty() == false) {
+        ScratchScope scratch;
+        stbtt_Rasterize(&bitmap, 0.35f, const_cast<stbtt_vertex *>(outline.data()), int(outline.size()), scale, scale, 0.0f, 0.0f, x0, y0, 1, mInfo.userdata);
     }
 
-    return cphd->second;
+    return true;
 }
 
 //-------------------------------------
 int
 FontSTB::GetKerning(uint32_t char1, uint32_t char2) {
-    auto it = mKerningData.find((uint64_t(char1) << 32) | uint64_t(char2));
-    if(it != mKerningData.end()) {
+    auto it = mKerning->find((uint64_t(char1) << 32) | uint64_t(char2));
+    CountKerningLookup(it != mKerning->end());
+    if(it != mKerning->end()) {
         return it->second;
     }
     return 0;
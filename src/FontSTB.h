@@ -7,29 +7,37 @@
 // See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
 //-----------------------------------------------------------------------------
 
-#include "Font.h"
-//-------------------------------------
-#include <stb/stb_truetype.h>
+#include "Font.h"       // And stb_truetype.h through FontFace.h (only once: FontSTB.cpp has its implementation)
 
 //-------------------------------------
 namespace MindShake {
 
     //---------------------------------
     class FontSTB : public Font {
+        protected:
+            using Outline     = FontVector<stbtt_vertex>;
+            using MapOutlines = FontHashMap<int, Outline>;
+
         public:
-            explicit                    FontSTB(const char *fontName);
+            explicit                    FontSTB(const char *fontName, FontAllocator *allocator = nullptr);
+            // A cheap handle over the face, packing its glyphs in the given atlas (nullptr: its own one)
+            explicit                    FontSTB(FontFace *face, AtlasManager *atlas = nullptr, FontAllocator *allocator = nullptr);
             virtual                     ~FontSTB();
 
         protected:
-            void                        GetKerningTable();
+            void                        Init(AtlasManager *atlas);
+            const Outline &             GetGlyphOutline(int glyph);
+            void                        GetGlyphOrigin(int glyph, uint8_t height, int32_t *pX, int32_t *pY);   // Of its bitmap, in pixels from the pen
             int                         GetKerning(uint32_t char1, uint32_t char2) override;
 
             const CodePointData &       GetCodePointData(uint32_t index) override;
-            const CodePointHeightData & GetCodePointDataForHeight(uint32_t index, uint8_t height) override;
+            bool                        GetGlyphBox(const CodePointData &codePoint, uint8_t height, CodePointHeightData *pData, int32_t *pWidth, int32_t *pHeight) override;
+            bool                        RenderGlyph(int glyph, uint8_t textHeight, uint8_t *pixels, int32_t width, int32_t height) override;
 
         protected:
-            stbtt_fontinfo  mInfo {};
-            uint8_t         *mFontBuffer {};
+            stbtt_fontinfo              mInfo {};           // Copy of the one of the face (offsets into its data)
+            const FontFace::MapKerning  *mKerning {};       // Of the face
+            MapOutlines                 mOutlines;          // Parsed once per glyph, rendered at any height
     };
 
 } // end of namespace
\ No newline at end of file
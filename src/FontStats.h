@@ -0,0 +1,88 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdint>
+
+//-------------------------------------
+// Build with FONT_RENDERER_STATS=1 (CMake option FONT_RENDERER_STATS) to collect the stats.
+// Otherwise the counters stay at zero and the hooks compile to nothing.
+#if !defined(FONT_RENDERER_STATS)
+    #define FONT_RENDERER_STATS 0
+#endif
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    enum class EFontEvent : uint8_t {
+        Rasterize,      // The backend renders a glyph
+        Antialias,      // AABlock / AABlockEx of a glyph
+        AtlasResize,    // Adding a glyph grew an atlas page or created a new one
+    };
+
+    // Per event timing hook
+    using FontEventCallback = void (*)(EFontEvent event, int32_t glyph, uint8_t height, uint64_t durationNs, void *userData);
+
+    //---------------------------------
+    // Durations in power of 2 microsecond buckets: [0, 1), [1, 2), [2, 4) ... [16384, inf)
+    struct TimeHistogram {
+        static constexpr uint32_t kNumBuckets = 16;
+
+        uint64_t    count;
+        uint64_t    totalNs;
+        uint64_t    maxNs;
+        uint64_t    buckets[kNumBuckets];
+
+        void        Add(uint64_t ns) {
+            uint64_t us     = ns / 1000;
+            uint32_t bucket = 0;
+            while(us != 0 && bucket < kNumBuckets - 1) {
+                us >>= 1;
+                ++bucket;
+            }
+            ++buckets[bucket];
+            ++count;
+            totalNs += ns;
+            if(maxNs < ns)
+                maxNs = ns;
+        }
+
+        double      GetAverageUs() const    { return count != 0 ? double(totalNs) / double(count) / 1000.0 : 0.0; }
+    };
+
+    //---------------------------------
+    struct FontStats {
+        uint64_t        glyphHits;          // Glyphs found in the cache
+        uint64_t        glyphMisses;        // Glyphs rendered on demand
+        uint64_t        kerningHits;
+        uint64_t        kerningMisses;
+        uint64_t        atlasResizes;
+        uint64_t        drawCalls;
+        uint64_t        glyphsDrawn;
+        uint64_t        bytesBlended;       // Destination bytes covered by the glyphs drawn and the cell backgrounds (after clipping)
+        TimeHistogram   rasterizeTime;
+        TimeHistogram   antialiasTime;
+    };
+
+    //---------------------------------
+    // Time since construction. Without FONT_RENDERER_STATS it does not read the clock.
+    class StatsTimer {
+        public:
+#if FONT_RENDERER_STATS
+            uint64_t    GetElapsedNs() const    { return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStart).count()); }
+
+        protected:
+            std::chrono::steady_clock::time_point   mStart { std::chrono::steady_clock::now() };
+#else
+            uint64_t    GetElapsedNs() const    { return 0; }
+#endif
+    };
+
+} // end of namespace
@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontTrace.h"
+//-------------------------------------
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+using namespace MindShake;
+
+//-------------------------------------
+namespace {
+
+    struct Event {
+        const char  *name;
+        const char  *argName1;
+        const char  *argName2;
+        int64_t     arg1;
+        int64_t     arg2;
+        uint64_t    startNs;
+        uint64_t    endNs;
+        uint32_t    thread;
+    };
+
+    // Events are kept in memory and written in blocks
+    const size_t kFlushEvents = 16384;
+
+    std::mutex          gMutex;
+    std::vector<Event>  gEvents;
+    FILE                *gFile {};
+    bool                gFirstEvent {};
+    uint32_t            gNumThreads {};
+
+    //---------------------------------
+    uint32_t
+    GetThreadId() {
+        static thread_local uint32_t id = 0;
+        if(id == 0) {
+            std::lock_guard<std::mutex> lock(gMutex);
+            id = ++gNumThreads;
+        }
+        return id;
+    }
+
+    //---------------------------------
+    void
+    Flush() {
+        for(const auto &event : gEvents) {
+            fprintf(gFile, "%s{\"name\":\"%s\",\"cat\":\"font\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                    gFirstEvent ? "" : ",\n", event.name, event.thread, event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0);
+            if(event.argName1 != nullptr) {
+                fprintf(gFile, ",\"args\":{\"%s\":%" PRId64, event.argName1, event.arg1);
+                if(event.argName2 != nullptr) {
+                    fprintf(gFile, ",\"%s\":%" PRId64, event.argName2, event.arg2);
+                }
+                fputc('}', gFile);
+            }
+            fputc('}', gFile);
+            gFirstEvent = false;
+        }
+        gEvents.clear();
+    }
+
+} // end of namespace
+
+//-------------------------------------
+std::atomic<bool> FontTrace::sActive { false };
+
+//-------------------------------------
+bool
+FontTrace::Begin(const char *fileName) {
+    End();
+
+    std::lock_guard<std::mutex> lock(gMutex);
+
+    gFile = fopen(fileName, "wb");
+    if(gFile == nullptr) {
+        fprintf(stderr, "Can't open trace file '%s'\n", fileName);
+        return false;
+    }
+
+    fputs("{\"traceEvents\":[\n", gFile);
+    gFirstEvent = true;
+    gEvents.reserve(kFlushEvents);
+    sActive.store(true, std::memory_order_relaxed);
+
+    return true;
+}
+
+//-------------------------------------
+void
+FontTrace::End() {
+    std::lock_guard<std::mutex> lock(gMutex);
+
+    sActive.store(false, std::memory_order_relaxed);
+    if(gFile == nullptr)
+        return;
+
+    Flush();
+    fputs("\n]}\n", gFile);
+    fclose(gFile);
+    gFile = nullptr;
+}
+
+//-------------------------------------
+uint64_t
+FontTrace::GetTimeNs() {
+    using Clock = std::chrono::steady_clock;
+
+    static const Clock::time_point start = Clock::now();
+
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+//-------------------------------------
+void
+FontTrace::AddEvent(const char *name, uint64_t startNs, uint64_t endNs, const char *argName1, int64_t arg1, const char *argName2, int64_t arg2) {
+    uint32_t thread = GetThreadId();
+
+    std::lock_guard<std::mutex> lock(gMutex);
+
+    // Ended meanwhile
+    if(gFile == nullptr)
+        return;
+
+    gEvents.push_back({ name, argName1, argName2, arg1, arg2, startNs, endNs, thread });
+    if(gEvents.size() >= kFlushEvents) {
+        Flush();
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdint>
+
+//-------------------------------------
+// Build with FONT_RENDERER_TRACE=1 (CMake option FONT_RENDERER_TRACE) to put trace scopes around
+// the rendering phases. Otherwise FONT_TRACE_SCOPE compiles to nothing.
+#if !defined(FONT_RENDERER_TRACE)
+    #define FONT_RENDERER_TRACE 0
+#endif
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Writes the trace events in Chrome trace JSON format (chrome://tracing, ui.perfetto.dev).
+    // Names must be string literals.
+    class FontTrace {
+        public:
+            static bool                 Begin(const char *fileName);
+            static void                 End();
+            static bool                 IsActive()                          { return sActive.load(std::memory_order_relaxed);  }
+
+            static uint64_t             GetTimeNs();
+            static void                 AddEvent(const char *name, uint64_t startNs, uint64_t endNs, const char *argName1, int64_t arg1, const char *argName2, int64_t arg2);
+
+        protected:
+            static std::atomic<bool>    sActive;
+    };
+
+    //---------------------------------
+    // Complete event ("X") from construction to destruction
+    class TraceScope {
+        public:
+            explicit                    TraceScope(const char *name, const char *argName1 = nullptr, int64_t arg1 = 0, const char *argName2 = nullptr, int64_t arg2 = 0) {
+                if(FontTrace::IsActive()) {
+                    mName     = name;
+                    mArgName1 = argName1;
+                    mArgName2 = argName2;
+                    mArg1     = arg1;
+                    mArg2     = arg2;
+                    mStartNs  = FontTrace::GetTimeNs();
+                }
+            }
+                                        ~TraceScope() {
+                if(mName != nullptr && FontTrace::IsActive()) {
+                    FontTrace::AddEvent(mName, mStartNs, FontTrace::GetTimeNs(), mArgName1, mArg1, mArgName2, mArg2);
+                }
+            }
+
+                                        TraceScope(const TraceScope &) = delete;
+            TraceScope &                operator = (const TraceScope &) = delete;
+
+        protected:
+            const char  *mName {};
+            const char  *mArgName1 {};
+            const char  *mArgName2 {};
+            int64_t     mArg1 {};
+            int64_t     mArg2 {};
+            uint64_t    mStartNs {};
+    };
+
+} // end of namespace
+
+//-------------------------------------
+#define FONT_TRACE_CONCAT_(a, b)    a##b
+#define FONT_TRACE_CONCAT(a, b)     FONT_TRACE_CONCAT_(a, b)
+
+#if FONT_RENDERER_TRACE
+    #define FONT_TRACE_SCOPE(...)   MindShake::TraceScope FONT_TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#else
+    #define FONT_TRACE_SCOPE(...)
+#endif
@@ -0,0 +1,109 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include <cstdint>
+
+//-------------------------------------
+// Internal: blending of an alpha glyph into a BGRA buffer, shared by Font and FontBaked so both draw the same pixels.
+// Header only, so FontBaked keeps needing nothing else from the font renderer.
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // color and *dst are 0xAARRGGBB, the result is opaque
+    inline void
+    BlendPixel(uint8_t alpha, uint32_t color, uint32_t *dst) {
+        uint32_t grey    = uint32_t((alpha * (color >> 24)) / 255);
+        uint32_t invGrey = 255 - grey;
+
+        uint32_t b = ((( color        & 0xff) * grey) + (( *dst        & 0xff) * invGrey)) / 255;
+        uint32_t g = ((((color >>  8) & 0xff) * grey) + (((*dst >>  8) & 0xff) * invGrey)) / 255;
+        uint32_t r = ((((color >> 16) & 0xff) * grey) + (((*dst >> 16) & 0xff) * invGrey)) / 255;
+        *dst = 0xff000000 | (r << 16) | (g << 8) | b;
+    }
+
+    //---------------------------------
+    // Blends the glyph stored at (u, v) of the texture with its top left corner at (currentX, currentY), clipped.
+    // A rotated glyph is stored transposed (width x height are those of the glyph, not of the texture rect).
+    // Returns the number of destination pixels covered by the glyph after clipping.
+    inline uint32_t
+    BlitAlpha(const uint8_t *texture, uint32_t textureStride, int32_t u, int32_t v, int32_t width, int32_t height, bool rotated, int32_t currentX, int32_t currentY, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t clipLeft, int32_t clipTop, int32_t clipRight, int32_t clipBottom) {
+        uint32_t offsetDst, offsetTexture;
+        int32_t  minX, maxX, minY, maxY;
+
+        // Clip Top
+        minY = 0;
+        if(currentY < clipTop) {
+            minY    += clipTop - currentY;
+            currentY = clipTop;
+        }
+
+        // Clip Bottom (if the beginning is beyond the bottom limit)
+        if(currentY >= clipBottom)
+            return 0;
+
+        // Clip Left
+        minX = 0;
+        if(currentX < clipLeft) {
+            minX    += clipLeft - currentX;
+            currentX = clipLeft;
+        }
+
+        // Clip Right (if the beginning is beyond the right limit)
+        if(currentX >= clipRight)
+            return 0;
+
+        // Clip Right
+        maxX = width;
+        if(currentX + maxX - minX >= clipRight) {
+            maxX = minX + clipRight - currentX;
+        }
+
+        // Clip Bottom
+        maxY = height;
+        if(currentY + maxY - minY >= clipBottom) {
+            maxY = minY + clipBottom - currentY;
+        }
+
+        // Let's draw
+        offsetDst = currentY * dstStride + currentX;
+        if(rotated == false) {
+            offsetTexture = (v + minY) * textureStride + u;
+            for(int32_t texY=minY; texY<maxY; ++texY) {
+                for(int32_t texX=minX, dstX=0; texX<maxX; ++texX, ++dstX) {
+                    if(texture[offsetTexture + texX] != 0) {
+                        BlendPixel(texture[offsetTexture + texX], color, &dst[offsetDst + dstX]);
+                    }
+                }
+                offsetTexture += textureStride;
+                offsetDst     += dstStride;
+            }
+        }
+        else {
+            // Glyph rows are atlas columns
+            offsetTexture = v * textureStride + u + minY;
+            for(int32_t texY=minY; texY<maxY; ++texY) {
+                for(int32_t texX=minX, dstX=0; texX<maxX; ++texX, ++dstX) {
+                    uint8_t alpha = texture[offsetTexture + texX * textureStride];
+                    if(alpha != 0) {
+                        BlendPixel(alpha, color, &dst[offsetDst + dstX]);
+                    }
+                }
+                offsetTexture += 1;
+                offsetDst     += dstStride;
+            }
+        }
+
+        if(maxX <= minX || maxY <= minY)
+            return 0;
+
+        return uint32_t((maxX - minX) * (maxY - minY));
+    }
+
+} // end of namespace
@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "ScratchArena.h"
+//-------------------------------------
+#include <algorithm>
+
+using namespace MindShake;
+
+//-------------------------------------
+const size_t ScratchArena::kMinChunkSize;
+
+//-------------------------------------
+ScratchArena::ScratchArena() {
+    mAllocator = FontAllocator::GetDefault();
+}
+
+//-------------------------------------
+ScratchArena::~ScratchArena() {
+    for(auto &chunk : mChunks) {
+        mAllocator->Free(chunk.memory, chunk.size);
+    }
+}
+
+//-------------------------------------
+ScratchArena &
+ScratchArena::GetThreadArena() {
+    static thread_local ScratchArena arena;
+
+    return arena;
+}
+
+//-------------------------------------
+void *
+ScratchArena::Allocate(size_t size) {
+    size = (size + 15) & ~size_t(15);
+
+    // Following chunks are free after a rewind
+    while(mCurrent < mChunks.size()) {
+        Chunk &chunk = mChunks[mCurrent];
+        if(mOffset + size <= chunk.size) {
+            void *memory = chunk.memory + mOffset;
+            mOffset += size;
+            return memory;
+        }
+        if(mCurrent + 1 == mChunks.size())
+            break;
+
+        ++mCurrent;
+        mOffset = 0;
+    }
+
+    // At least doubles the capacity
+    Chunk chunk;
+    chunk.size   = std::max(size, std::max(kMinChunkSize, GetCapacity()));
+    chunk.memory = static_cast<uint8_t *>(mAllocator->Allocate(chunk.size));
+    if(chunk.memory == nullptr)
+        return nullptr;
+
+    ++mNumHeapAllocations;
+    mChunks.push_back(chunk);
+    mCurrent = uint32_t(mChunks.size() - 1);
+    mOffset  = size;
+
+    return chunk.memory;
+}
+
+//-------------------------------------
+void
+ScratchArena::Rewind(const Marker &marker) {
+    mCurrent = marker.chunk;
+    mOffset  = marker.offset;
+
+    // Empty: one chunk with the whole capacity, so the next rounds fit in it
+    if(mCurrent == 0 && mOffset == 0 && mChunks.size() > 1) {
+        size_t capacity = GetCapacity();
+        for(auto &chunk : mChunks) {
+            mAllocator->Free(chunk.memory, chunk.size);
+        }
+        mChunks.clear();
+
+        Chunk chunk;
+        chunk.size   = capacity;
+        chunk.memory = static_cast<uint8_t *>(mAllocator->Allocate(chunk.size));
+        if(chunk.memory != nullptr) {
+            ++mNumHeapAllocations;
+            mChunks.push_back(chunk);
+        }
+    }
+}
+
+//-------------------------------------
+size_t
+ScratchArena::GetCapacity() const {
+    size_t capacity = 0;
+    for(const auto &chunk : mChunks) {
+        capacity += chunk.size;
+    }
+
+    return capacity;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontAllocator.h"
+//-------------------------------------
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Per thread bump allocator for the temporary buffers of a glyph miss (rasterizer scratch, antialias buffers).
+    // Memory is given back when the enclosing ScratchScope ends, but the chunks are kept: once warmed up
+    // a miss does not touch the heap. The chunks come from the default FontAllocator when the arena is created.
+    class ScratchArena {
+        public:
+            struct Marker {
+                uint32_t    chunk;
+                size_t      offset;
+            };
+
+        public:
+                                        ScratchArena();
+                                        ~ScratchArena();
+
+                                        ScratchArena(const ScratchArena &) = delete;
+            ScratchArena &              operator = (const ScratchArena &) = delete;
+
+            static ScratchArena &       GetThreadArena();
+
+            // Aligned to 16 bytes. Returns nullptr if there is no memory.
+            void *                      Allocate(size_t size);
+
+            Marker                      GetMarker() const                   { return { mCurrent, mOffset };             }
+            // Frees everything allocated after the marker
+            void                        Rewind(const Marker &marker);
+
+            size_t                      GetCapacity() const;
+            uint64_t                    GetNumHeapAllocations() const       { return mNumHeapAllocations;               }
+
+        protected:
+            struct Chunk {
+                uint8_t     *memory;
+                size_t      size;
+            };
+
+            static const size_t kMinChunkSize = 64 * 1024;
+
+            FontAllocator       *mAllocator {};
+            FontVector<Chunk>   mChunks;
+            uint32_t            mCurrent {};
+            size_t              mOffset {};
+            uint64_t            mNumHeapAllocations {};
+    };
+
+    //---------------------------------
+    // Scratch memory of the thread allocated while alive is freed at the end
+    class ScratchScope {
+        public:
+                                        ScratchScope() : mArena(ScratchArena::GetThreadArena()), mMarker(mArena.GetMarker())   { }
+                                        ~ScratchScope()                     { mArena.Rewind(mMarker);                   }
+
+                                        ScratchScope(const ScratchScope &) = delete;
+            ScratchScope &              operator = (const ScratchScope &) = delete;
+
+            uint8_t *                   AllocateBytes(size_t size)          { return static_cast<uint8_t *>(mArena.Allocate(size));   }
+
+        protected:
+            ScratchArena            &mArena;
+            ScratchArena::Marker    mMarker;
+    };
+
+} // end of namespace
@@ -0,0 +1,440 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "SharedAtlas.h"
+#include "UTF8_Utils.h"
+//-------------------------------------
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <type_traits>
+//-------------------------------------
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define SHARED_ATLAS_POSIX
+#endif
+
+using namespace MindShake;
+
+// The atomics live in memory mapped by several processes
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "SharedAtlas needs lock free atomics");
+static_assert(std::is_trivially_copyable<CodePointHeightData>::value, "CodePointHeightData is copied to shared memory");
+
+//-------------------------------------
+// Segment: Header | Entry[tableSize] | texture (width x height)
+struct SharedAtlas::Header {
+    uint32_t                magic;
+    uint32_t                entrySize;      // Processes built with a different layout refuse it
+    uint32_t                width;
+    uint32_t                height;
+    uint32_t                tableSize;      // Power of 2, twice maxGlyphs at least
+    uint32_t                maxGlyphs;
+    std::atomic<uint32_t>   sequence;
+    std::atomic<uint32_t>   numGlyphs;
+};
+
+static const uint32_t kMagic = 0x41544C53;  // 'ATLS'
+
+//-------------------------------------
+static size_t
+AlignSize(size_t size) {
+    return (size + 63) & ~size_t(63);
+}
+
+//-------------------------------------
+SharedAtlas::~SharedAtlas() {
+    Close();
+}
+
+//-------------------------------------
+bool
+SharedAtlas::Create(const char *name, uint32_t width, uint32_t height, uint32_t maxGlyphs) {
+    Close();
+
+    if(name == nullptr || width == 0 || height == 0 || maxGlyphs == 0)
+        return false;
+
+#if defined(SHARED_ATLAS_POSIX)
+    uint32_t tableSize = 16;
+    while(tableSize < maxGlyphs * 2)
+        tableSize <<= 1;
+
+    size_t offsetEntries = AlignSize(sizeof(Header));
+    size_t offsetTexture = AlignSize(offsetEntries + tableSize * sizeof(Entry));
+    size_t size          = offsetTexture + size_t(width) * height;
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0) {
+        fprintf(stderr, "Can't create shared memory '%s'\n", name);
+        return false;
+    }
+
+    // The new segment is zero filled: all the entries are free
+    void *memory = MAP_FAILED;
+    if(ftruncate(fd, off_t(size)) == 0) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(memory == MAP_FAILED) {
+        fprintf(stderr, "Not enough memory\n");
+        shm_unlink(name);
+        return false;
+    }
+
+    mName       = name;
+    mMemory     = memory;
+    mSize       = size;
+    mHeader     = new (memory) Header;
+    mEntries    = reinterpret_cast<Entry *>(static_cast<uint8_t *>(memory) + offsetEntries);
+    mTexture    = static_cast<uint8_t *>(memory) + offsetTexture;
+    mTableSize  = tableSize;
+    mIsProducer = true;
+    mPacker.Init(width, height, false);
+
+    mHeader->entrySize = uint32_t(sizeof(Entry));
+    mHeader->width     = width;
+    mHeader->height    = height;
+    mHeader->tableSize = tableSize;
+    mHeader->maxGlyphs = maxGlyphs;
+    mHeader->sequence.store(0, std::memory_order_relaxed);
+    mHeader->numGlyphs.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mHeader->magic     = kMagic;
+
+    return true;
+#else
+    fprintf(stderr, "Shared memory is not supported on this platform\n");
+    return false;
+#endif
+}
+
+//-------------------------------------
+bool
+SharedAtlas::Open(const char *name) {
+    Close();
+
+    if(name == nullptr)
+        return false;
+
+#if defined(SHARED_ATLAS_POSIX)
+    int fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0) {
+        fprintf(stderr, "Can't open shared memory '%s'\n", name);
+        return false;
+    }
+
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(Header)) {
+        memory = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(memory == MAP_FAILED) {
+        fprintf(stderr, "Can't map shared memory '%s'\n", name);
+        return false;
+    }
+
+    mMemory = memory;
+    mSize   = size_t(info.st_size);
+
+    Header   *header   = static_cast<Header *>(memory);
+    uint32_t tableSize = header->tableSize;     // Read once: the one validated is the one used
+    size_t offsetEntries = AlignSize(sizeof(Header));
+    size_t offsetTexture = AlignSize(offsetEntries + size_t(tableSize) * sizeof(Entry));
+    bool   valid = header->magic == kMagic && header->entrySize == sizeof(Entry) &&
+                   tableSize != 0 && (tableSize & (tableSize - 1)) == 0 &&
+                   offsetTexture + size_t(header->width) * header->height <= mSize;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(valid == false) {
+        fprintf(stderr, "Invalid shared atlas '%s'\n", name);
+        Close();
+        return false;
+    }
+
+    mName      = name;
+    mHeader    = header;
+    mEntries   = reinterpret_cast<Entry *>(static_cast<uint8_t *>(memory) + offsetEntries);
+    mTexture   = static_cast<uint8_t *>(memory) + offsetTexture;
+    mTableSize = tableSize;
+
+    return true;
+#else
+    fprintf(stderr, "Shared memory is not supported on this platform\n");
+    return false;
+#endif
+}
+
+//-------------------------------------
+void
+SharedAtlas::Close() {
+#if defined(SHARED_ATLAS_POSIX)
+    if(mMemory != nullptr) {
+        munmap(mMemory, mSize);
+    }
+    if(mIsProducer) {
+        shm_unlink(mName.c_str());
+    }
+#endif
+
+    mName.clear();
+    mMemory     = nullptr;
+    mSize       = 0;
+    mHeader     = nullptr;
+    mEntries    = nullptr;
+    mTexture    = nullptr;
+    mTableSize  = 0;
+    mIsProducer = false;
+}
+
+//-------------------------------------
+uint32_t
+SharedAtlas::Publish(Font &font, uint8_t fontId, const char *utf8, const uint8_t *heights, uint32_t numHeights) {
+    struct Pending {
+        uint64_t            key;
+        CodePointHeightData data;   // In the font atlas
+    };
+
+    // Scratch of the producer, on the allocator of its font
+    FontVector<Pending>             pending { FontVector<Pending>::allocator_type(font.mAllocator) };
+    FontHashSet<uint64_t>           keys { FontHashSet<uint64_t>::allocator_type(font.mAllocator) };
+    uint32_t                        codePoint;
+    uint32_t                        added = 0;
+
+    if(mIsProducer == false || utf8 == nullptr || heights == nullptr || font.mStatus < 0)
+        return 0;
+
+    font.PreloadGlyphs(utf8, heights, numHeights);
+
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        for(uint32_t i=0; i<numHeights; ++i) {
+            if(heights[i] == 0)
+                continue;
+
+            uint64_t key = MakeKey(fontId, codePoint, heights[i]);
+            if(keys.insert(key).second == false || FindEntry(key) != nullptr)
+                continue;
+
+            const CodePointHeightData &data = font.GetCodePointDataForHeight(codePoint, heights[i]);
+            if(data.glyph > 0) {
+                pending.push_back({ key, data });
+            }
+        }
+    }
+
+    // Tallest first packs better. The glyphs keep the orientation they have in the font atlas.
+    std::sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) {
+        if(a.data.rect.height != b.data.rect.height)
+            return a.data.rect.height > b.data.rect.height;
+        return a.data.rect.width > b.data.rect.width;
+    });
+
+    const uint32_t width = mHeader->width;
+    for(const auto &glyph : pending) {
+        if(mHeader->numGlyphs.load(std::memory_order_relaxed) >= mHeader->maxGlyphs)
+            break;
+
+        const Rect &src = glyph.data.rect;
+        Rect rect = mPacker.Insert(src.width, src.height, SkylineBinPack::ELevelChoiceHeuristic::LevelBottomLeft);
+        if(rect.width <= 0)
+            continue;
+
+        const uint8_t *srcTexture = font.mAtlas->GetPageTexture(glyph.data.page);
+        uint32_t       srcStride  = font.mAtlas->GetPageWidth();
+        for(int y=0; y<src.height; ++y) {
+            memcpy(&mTexture[(rect.y + y) * width + rect.x], &srcTexture[(src.y + y) * srcStride + src.x], src.width);
+        }
+
+        Entry *entry = FindFreeEntry(glyph.key);
+        entry->data      = glyph.data;
+        entry->data.page = 0;
+        entry->data.rect = rect;
+        // Publish: the pixels and the data are visible before the key
+        entry->key.store(glyph.key, std::memory_order_release);
+        mHeader->numGlyphs.fetch_add(1, std::memory_order_release);
+        ++added;
+    }
+
+    return added;
+}
+
+//-------------------------------------
+void
+SharedAtlas::Reset() {
+    if(mIsProducer == false)
+        return;
+
+    // Odd while the entries are removed: readers discard what they got meanwhile
+    mHeader->sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for(uint32_t i=0; i<mHeader->tableSize; ++i) {
+        mEntries[i].key.store(0, std::memory_order_relaxed);
+    }
+    memset(mTexture, 0, size_t(mHeader->width) * mHeader->height);
+    mHeader->numGlyphs.store(0, std::memory_order_relaxed);
+    mPacker.Init(mHeader->width, mHeader->height, false);
+
+    mHeader->sequence.fetch_add(1, std::memory_order_release);
+}
+
+//-------------------------------------
+bool
+SharedAtlas::Find(uint8_t fontId, uint32_t codePoint, uint8_t height, CodePointHeightData *pData) const {
+    if(mHeader == nullptr || pData == nullptr)
+        return false;
+
+    uint32_t sequence = mHeader->sequence.load(std::memory_order_acquire);
+    if(sequence & 1)
+        return false;
+
+    const Entry *entry = FindEntry(MakeKey(fontId, codePoint, height));
+    if(entry == nullptr)
+        return false;
+
+    *pData = entry->data;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return mHeader->sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+//-------------------------------------
+// Same layout as Font::DrawText
+bool
+SharedAtlas::DrawText(Font &font, uint8_t fontId, const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) const {
+    if(mHeader == nullptr || utf8 == nullptr || textHeight == 0 || font.mStatus < 0)
+        return false;
+
+    uint32_t codePoint;
+    uint32_t offsetTextX, offsetTextY;
+    bool     complete = true;
+
+    uint32_t sequence = mHeader->sequence.load(std::memory_order_acquire);
+    if(sequence & 1)
+        return false;
+
+    // Every glyph is looked up before drawing: a missing one (or a reset meanwhile) leaves dst untouched
+    for(const char *text = utf8; (codePoint = GetNextUTF32(&text)) != 0; ) {
+        if(codePoint != '\n' && FindEntry(MakeKey(fontId, codePoint, textHeight)) == nullptr && font.GetCodePointGlyph(codePoint) != 0)
+            return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(mHeader->sequence.load(std::memory_order_relaxed) != sequence)
+        return false;
+
+    Color32 fontColor = *reinterpret_cast<Color32 *>(&color);
+
+    const HeightData &heightData = font.GetDataForHeight(textHeight);
+
+    posY += heightData.ascent; // baseline
+
+    font.CountDrawCall();
+
+    offsetTextX = 0;
+    offsetTextY = 0;
+    while((codePoint = GetNextUTF32(&utf8)) != 0) {
+        if(codePoint == '\n') {
+            offsetTextX = 0;
+            offsetTextY += (heightData.ascent - heightData.descent);
+            continue;
+        }
+
+        const Entry *entry = FindEntry(MakeKey(fontId, codePoint, textHeight));
+        if(entry == nullptr) {
+            // Missing in the font, or reset since the lookup
+            complete &= font.GetCodePointGlyph(codePoint) == 0;
+            continue;
+        }
+
+        const CodePointHeightData &data = entry->data;
+        font.CountBlit(Font::BlitGlyph(mTexture, mHeader->width, data.rect, data.rotated, posX + data.x + offsetTextX, posY + data.y + offsetTextY, fontColor, dst, dstStride, font.mLeft, font.mTop, font.mRight, font.mBottom));
+        offsetTextX += data.advanceWidth + uint32_t(font.GetKerning(data.glyph, font.GetCodePointGlyph(*utf8)) * heightData.scale);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return complete && mHeader->sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+//-------------------------------------
+uint32_t
+SharedAtlas::GetVersion() const {
+    return mHeader != nullptr ? mHeader->sequence.load(std::memory_order_acquire) : 0;
+}
+
+//-------------------------------------
+uint32_t
+SharedAtlas::GetNumGlyphs() const {
+    return mHeader != nullptr ? mHeader->numGlyphs.load(std::memory_order_acquire) : 0;
+}
+
+//-------------------------------------
+uint32_t
+SharedAtlas::GetTextureWidth() const {
+    return mHeader != nullptr ? mHeader->width : 0;
+}
+
+//-------------------------------------
+uint32_t
+SharedAtlas::GetTextureHeight() const {
+    return mHeader != nullptr ? mHeader->height : 0;
+}
+
+//-------------------------------------
+uint64_t
+SharedAtlas::MakeKey(uint8_t fontId, uint32_t codePoint, uint8_t height) {
+    CodePointHeight cph {};
+
+    cph.codePoint = codePoint;
+    cph.height    = height;
+
+    return (uint64_t(fontId) << 32) | cph.value;    // Never 0 (code point 0 ends the text)
+}
+
+//-------------------------------------
+static inline uint32_t
+HashKey(uint64_t key, uint32_t tableSize) {
+    return uint32_t((key * 0x9E3779B97F4A7C15ull) >> 32) & (tableSize - 1);
+}
+
+//-------------------------------------
+// Linear probing. Entries are only removed all at once (Reset), so a free one ends the search.
+// At most tableSize probes (the size validated when mapping, not the one in shared memory now):
+// a full or corrupt table must not hang the consumer.
+const SharedAtlas::Entry *
+SharedAtlas::FindEntry(uint64_t key) const {
+    const uint32_t mask = mTableSize - 1;
+
+    uint32_t index = HashKey(key, mTableSize);
+    for(uint32_t probe = 0; probe < mTableSize; ++probe, index = (index + 1) & mask) {
+        uint64_t entryKey = mEntries[index].key.load(std::memory_order_acquire);
+        if(entryKey == key)
+            return &mEntries[index];
+        if(entryKey == 0)
+            return nullptr;
+    }
+
+    return nullptr;
+}
+
+//-------------------------------------
+// The table is at most half full (tableSize >= maxGlyphs * 2)
+SharedAtlas::Entry *
+SharedAtlas::FindFreeEntry(uint64_t key) {
+    const uint32_t mask = mHeader->tableSize - 1;
+
+    uint32_t index = HashKey(key, mHeader->tableSize);
+    while(mEntries[index].key.load(std::memory_order_relaxed) != 0) {
+        index = (index + 1) & mask;
+    }
+
+    return &mEntries[index];
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "Font.h"
+#include "SkylineBinPack.h"
+//-------------------------------------
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Glyph atlas in a named shared memory segment (POSIX shm_open), so several processes
+    // draw the same glyphs without rasterizing them again.
+    // One producer renders the glyphs with its fonts and publishes them. Consumers open the
+    // segment read only and draw from it; their fonts only give the metrics and the kerning.
+    // Published glyphs never move: an entry becomes visible once its key is stored (after its
+    // pixels and data), and Reset is the only change guarded by the sequence counter (seqlock).
+    class SharedAtlas {
+        public:
+            using Rect                   = SkylineBinPack::Rect;
+
+        public:
+                                        SharedAtlas() = default;
+                                        ~SharedAtlas();
+
+                                        SharedAtlas(const SharedAtlas &) = delete;
+            SharedAtlas &               operator = (const SharedAtlas &) = delete;
+
+            // Producer: creates (or replaces) the segment with a texture of width x height and room for maxGlyphs.
+            // The name follows shm_open rules ("/name").
+            bool                        Create(const char *name, uint32_t width, uint32_t height, uint32_t maxGlyphs);
+            // Consumer: maps an existing segment
+            bool                        Open(const char *name);
+            // The producer also removes the name (mapped consumers keep working)
+            void                        Close();
+
+            bool                        IsOpen() const                      { return mHeader != nullptr;                }
+            bool                        IsProducer() const                  { return mIsProducer;                       }
+
+            // Producer: renders the code points of utf8 at every height with the font and publishes
+            // them under fontId (each process must use the same id for the same font file).
+            // Returns the number of glyphs added.
+            uint32_t                    Publish(Font &font, uint8_t fontId, const char *utf8, const uint8_t *heights, uint32_t numHeights);
+            // Producer: removes all the glyphs
+            void                        Reset();
+
+            bool                        Find(uint8_t fontId, uint32_t codePoint, uint8_t height, CodePointHeightData *pData) const;
+
+            // Draws like Font::DrawText (with the clipping of the font) using the published glyphs.
+            // Returns false, with dst untouched, if some glyph is not published. Also returns false if the producer
+            // reset the atlas while drawing: then dst may be partly drawn (even with cleared glyphs), so clear it and
+            // draw again (e.g. with the font).
+            bool                        DrawText(Font &font, uint8_t fontId, const char *utf8, uint8_t textHeight, uint32_t color, uint32_t *dst, uint32_t dstStride, int32_t posX, int32_t posY) const;
+
+            // Changes on every Reset (odd while resetting)
+            uint32_t                    GetVersion() const;
+            uint32_t                    GetNumGlyphs() const;
+            const uint8_t *             GetTexture() const                  { return mTexture;                          }
+            uint32_t                    GetTextureWidth() const;
+            uint32_t                    GetTextureHeight() const;
+
+        protected:
+            struct Header;
+
+            struct Entry {
+                std::atomic<uint64_t>   key;        // 0: free
+                CodePointHeightData     data;       // page is always 0
+            };
+
+            static uint64_t             MakeKey(uint8_t fontId, uint32_t codePoint, uint8_t height);
+            const Entry *               FindEntry(uint64_t key) const;
+            Entry *                     FindFreeEntry(uint64_t key);
+
+        protected:
+            FontString          mName;              // Default FontAllocator, like the packer
+            void                *mMemory {};
+            size_t              mSize {};
+            Header              *mHeader {};
+            Entry               *mEntries {};
+            uint8_t             *mTexture {};
+            uint32_t            mTableSize {};      // Entries mapped
+            SkylineBinPack      mPacker { false };  // Only in the producer
+            bool                mIsProducer {};
+    };
+
+} // end of namespace
@@ -10,15 +10,17 @@ namespace MindShake {
 
     //---------------------------------
     void
-    SkylineBinPack::Init(uint32_t width, uint32_t height, bool allowRotation) {
+    SkylineBinPack::Init(uint32_t width, uint32_t height, bool allowRotation, bool useWasteMap) {
         SkylineNode	node;
 
         mBinWidth        = width;
         mBinHeight       = height;
         mAllowRotation   = allowRotation;
+        mUseWasteMap     = useWasteMap;
         mUsedSurfaceArea = 0;
 
         mSkyLine.clear();
+        mWasteMap.clear();
 
         node.x     = 0;
         node.y     = 0;
@@ -34,6 +36,7 @@ namespace MindShake {
         mUsedSurfaceArea = 0;
 
         mSkyLine.clear();
+        mWasteMap.clear();
 
         node.x     = 0;
         node.y     = 0;
@@ -41,6 +44,15 @@ namespace MindShake {
         mSkyLine.push_back(node);
     }
 
+    //---------------------------------
+    void
+    SkylineBinPack::SetUseWasteMap(bool set) {
+        mUseWasteMap = set;
+        if(set == false) {
+            mWasteMap.clear();
+        }
+    }
+
     //---------------------------------
     bool
     SkylineBinPack::ResizeBin(uint32_t width, uint32_t height) {
@@ -55,6 +67,7 @@ namespace MindShake {
             node.width = width - mBinWidth;
 
             mSkyLine.push_back(node);
+            _MergeSkylines();
         }
 
         mBinWidth  = width;
@@ -63,9 +76,99 @@ namespace MindShake {
         return true;
     }
 
+    //---------------------------------
+    bool
+    SkylineBinPack::ShrinkBin(uint32_t height) {
+        if(height > mBinHeight || GetUsedHeight() > height)
+            return false;
+
+        mBinHeight = height;
+
+        return true;
+    }
+
+    //---------------------------------
+    int32_t
+    SkylineBinPack::GetUsedHeight() const {
+        uint32_t    height = 0;
+
+        for(const auto &node : mSkyLine) {
+            if(height < node.y)
+                height = node.y;
+        }
+
+        return height;
+    }
+
+    //---------------------------------
+    bool
+    SkylineBinPack::Validate() const {
+        int32_t x = 0;
+
+        for(const auto &node : mSkyLine) {
+            if(node.x != x || node.width <= 0 || node.y < 0 || node.y > mBinHeight)
+                return false;
+            x += node.width;
+        }
+        if(x != mBinWidth)
+            return false;
+
+        for(size_t i = 0; i < mWasteMap.size(); ++i) {
+            const Rect &waste = mWasteMap[i];
+            if(waste.width <= 0 || waste.height <= 0 || waste.x < 0 || waste.y < 0 || waste.right() > mBinWidth)
+                return false;
+
+            // Holes are below the skyline
+            if(_OverlapsSkyline(waste))
+                return false;
+
+            for(size_t j = i + 1; j < mWasteMap.size(); ++j) {
+                const Rect &other = mWasteMap[j];
+                if(waste.x < other.right() && other.x < waste.right() && waste.y < other.bottom() && other.y < waste.bottom())
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    //---------------------------------
+    bool
+    SkylineBinPack::_OverlapsSkyline(const Rect &rRect) const {
+        for(const auto &node : mSkyLine) {
+            if(node.x < rRect.right() && node.x + node.width > rRect.x && node.y < rRect.bottom())
+                return true;
+        }
+
+        return false;
+    }
+
+    //---------------------------------
+    bool
+    SkylineBinPack::OverlapsFreeSpace(const Rect &rRect) const {
+        if(_OverlapsSkyline(rRect))
+            return true;
+
+        for(const auto &waste : mWasteMap) {
+            if(waste.x < rRect.right() && rRect.x < waste.right() && waste.y < rRect.bottom() && rRect.y < waste.bottom())
+                return true;
+        }
+
+        return false;
+    }
+
     //---------------------------------
     SkylineBinPack::Rect
     SkylineBinPack::Insert(uint32_t width, uint32_t height, ELevelChoiceHeuristic method) {
+        Rect    newNode;
+
+        if(mUseWasteMap) {
+            newNode = _InsertWasteMap(width, height);
+            if(newNode.height > 0) {
+                mUsedSurfaceArea += width * height;
+                return newNode;
+            }
+        }
 
         switch(method) {
             case ELevelChoiceHeuristic::LevelBottomLeft:
@@ -79,6 +182,114 @@ namespace MindShake {
     }
 
 
+    //---------------------------------
+    // Waste Map
+    //---------------------------------
+
+    //---------------------------------
+    // Best short side fit among the holes, then guillotine split of the rest along the shorter leftover axis
+    SkylineBinPack::Rect
+    SkylineBinPack::_InsertWasteMap(uint32_t width, uint32_t height) {
+        int32_t     bestIndex     = -1;
+        uint32_t    bestShortSide = 0x7fffffff;
+        uint32_t    bestLongSide  = 0x7fffffff;
+        bool        bestRotated   = false;
+
+        auto tryFit = [&](size_t i, uint32_t w, uint32_t h, bool rotated) {
+            const Rect &free = mWasteMap[i];
+            if(w > free.width || h > free.height)
+                return;
+
+            uint32_t shortSide = std::min(free.width - w, free.height - h);
+            uint32_t longSide  = std::max(free.width - w, free.height - h);
+            if(shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide)) {
+                bestIndex     = int32_t(i);
+                bestShortSide = shortSide;
+                bestLongSide  = longSide;
+                bestRotated   = rotated;
+            }
+        };
+
+        for(size_t i = 0; i < mWasteMap.size(); ++i) {
+            tryFit(i, width, height, false);
+            if(mAllowRotation && width != height) {
+                tryFit(i, height, width, true);
+            }
+        }
+
+        if(bestIndex == -1)
+            return { 0, 0, 0, 0 };
+
+        if(bestRotated) {
+            std::swap(width, height);
+        }
+
+        Rect free    = mWasteMap[bestIndex];
+        Rect newNode = { free.x, free.y, width, height };
+
+        mWasteMap[bestIndex] = mWasteMap.back();
+        mWasteMap.pop_back();
+
+        Rect bottom = { free.x, free.y + height, 0, free.height - height };
+        Rect right  = { free.x + width, free.y, free.width - width, 0 };
+        if(free.width - width <= free.height - height) {
+            bottom.width = free.width;
+            right.height = height;
+        }
+        else {
+            bottom.width = width;
+            right.height = free.height;
+        }
+
+        _AddWasteRect(bottom);
+        _AddWasteRect(right);
+
+        return newNode;
+    }
+
+    //---------------------------------
+    // Slivers are not worth the search time and the list is bounded
+    void
+    SkylineBinPack::_AddWasteRect(const Rect &rRect) {
+        if(rRect.width < kMinWasteSide || rRect.height < kMinWasteSide)
+            return;
+
+        if(int(mWasteMap.size()) >= kMaxWasteRects) {
+            auto smallest = std::min_element(mWasteMap.begin(), mWasteMap.end(), [](const Rect &a, const Rect &b) {
+                return a.width * a.height < b.width * b.height;
+            });
+            if(smallest->width * smallest->height >= rRect.width * rRect.height)
+                return;
+
+            *smallest = rRect;
+            return;
+        }
+
+        mWasteMap.push_back(rRect);
+    }
+
+    //---------------------------------
+    // Keeps the space between the skyline and the bottom of a new level
+    void
+    SkylineBinPack::_AddWasteMapArea(int32_t nodeIndex, const Rect &rRect) {
+        const uint32_t	rectLeft  = rRect.x;
+        const uint32_t	rectRight = rRect.x + rRect.width;
+        uint32_t		leftSide, rightSide;
+
+        for(; (nodeIndex < int(mSkyLine.size())) && (mSkyLine[nodeIndex].x < rectRight); ++nodeIndex) {
+            if(mSkyLine[nodeIndex].x + mSkyLine[nodeIndex].width <= rectLeft)
+                break;
+
+            assert(rRect.y >= mSkyLine[nodeIndex].y);
+            if(rRect.y == mSkyLine[nodeIndex].y)
+                continue;
+
+            leftSide  = mSkyLine[nodeIndex].x;
+            rightSide = std::min(rectRight, leftSide + mSkyLine[nodeIndex].width);
+            _AddWasteRect({ leftSide, mSkyLine[nodeIndex].y, rightSide - leftSide, rRect.y - mSkyLine[nodeIndex].y });
+        }
+    }
+
     //---------------------------------
     // Bottom Left Heuristic
     //---------------------------------
@@ -116,7 +327,14 @@ namespace MindShake {
 
         memset(&newNode, 0, sizeof(newNode));
 
+        // A placement is never above its node, so the nodes that can not beat
+        // the best height found are skipped without walking the skyline.
+        const uint32_t minSide = mAllowRotation ? std::min(width, height) : height;
+
         for(size_t i = 0; i < mSkyLine.size(); ++i) {
+            if(mSkyLine[i].y + minSide > (*pBestHeight))
+                continue;
+
             if(_RectangleFits(int(i), width, height, &y)) {
                 if((y + height < (*pBestHeight)) || ((y + height == (*pBestHeight)) && (mSkyLine[i].width < (*pBestWidth)))) {
                     *pBestIndex  = int(i);
@@ -295,6 +513,10 @@ namespace MindShake {
         SkylineNode	newNode;
         uint32_t	shrink;
 
+        if(mUseWasteMap) {
+            _AddWasteMapArea(nodeIndex, rRect);
+        }
+
         newNode.x     = rRect.x;
         newNode.y     = rRect.y + rRect.height;
         newNode.width = rRect.width;
@@ -326,7 +548,7 @@ namespace MindShake {
             }
         }
 
-        _MergeSkylines();
+        _MergeSkylines(nodeIndex);
     }
 
     //---------------------------------
@@ -341,4 +563,19 @@ namespace MindShake {
         }
     }
 
+    //---------------------------------
+    // Only the new level can be at the height of its neighbours
+    void
+    SkylineBinPack::_MergeSkylines(int32_t nodeIndex) {
+        if(nodeIndex + 1 < int(mSkyLine.size()) && mSkyLine[nodeIndex].y == mSkyLine[nodeIndex+1].y) {
+            mSkyLine[nodeIndex].width += mSkyLine[nodeIndex+1].width;
+            mSkyLine.erase(mSkyLine.begin() + (nodeIndex+1));
+        }
+
+        if(nodeIndex > 0 && mSkyLine[nodeIndex-1].y == mSkyLine[nodeIndex].y) {
+            mSkyLine[nodeIndex-1].width += mSkyLine[nodeIndex].width;
+            mSkyLine.erase(mSkyLine.begin() + nodeIndex);
+        }
+    }
+
 } // end of namespace
@@ -6,8 +6,9 @@
 // Modified by Carlos Aragonés
 //-------------------------------------
 
+#include "FontAllocator.h"
+//-------------------------------------
 #include <cstdint>
-#include <vector>
 
 
 //-------------------------------------
@@ -41,15 +42,27 @@ namespace MindShake {
             };
 
         public:
-                        SkylineBinPack(bool allowRotation = true)                                  { Init(    1,      1, allowRotation); }
-                        SkylineBinPack(uint32_t width, uint32_t height, bool allowRotation = true) { Init(width, height, allowRotation); }
-
-            // (Re)initializes the packer to an empty bin of width x height units.
-            void	    Init(uint32_t width, uint32_t height, bool allowRotation = true);
+            // The skyline and the waste map come from the allocator (nullptr: FontAllocator::GetDefault()), which must outlive it
+                        SkylineBinPack(bool allowRotation = true, bool useWasteMap = false, FontAllocator *allocator = nullptr)
+                            : mSkyLine(FontVector<SkylineNode>::allocator_type(allocator)), mWasteMap(FontVector<Rect>::allocator_type(allocator))    { Init(    1,      1, allowRotation, useWasteMap); }
+                        SkylineBinPack(uint32_t width, uint32_t height, bool allowRotation = true, bool useWasteMap = false, FontAllocator *allocator = nullptr)
+                            : mSkyLine(FontVector<SkylineNode>::allocator_type(allocator)), mWasteMap(FontVector<Rect>::allocator_type(allocator))    { Init(width, height, allowRotation, useWasteMap); }
+
+            // (Re)initializes the packer to an empty bin of width x height units (keeping its allocator).
+            void	    Init(uint32_t width, uint32_t height, bool allowRotation = true, bool useWasteMap = false);
             void        Reset();
 
+            // Rotated rectangles are returned with width and height swapped
+            void        SetAllowRotation(bool set)									{ mAllowRotation = set;     }
+            bool        GetAllowRotation() const									{ return mAllowRotation;   }
+            // The holes left below new skyline levels are kept and tried before the skyline
+            void        SetUseWasteMap(bool set);
+            bool        GetUseWasteMap() const										{ return mUseWasteMap;     }
+
             // Resizes the Bin (if the new size is greatest)
             bool	    ResizeBin(uint32_t width, uint32_t height);
+            // Reduces the height of the Bin (if nothing has been packed beyond it)
+            bool	    ShrinkBin(uint32_t height);
 
             // Inserts a single rectangle into the bin, possibly rotated.
             Rect	    Insert(uint32_t width, uint32_t height, ELevelChoiceHeuristic method);
@@ -57,8 +70,18 @@ namespace MindShake {
             uint32_t    GetWidth() const											{ return mBinWidth;        }
             uint32_t	GetHeight()	const											{ return mBinHeight;       }
             uint32_t	GetUsedSurfaceArea() const									{ return mUsedSurfaceArea; }
+            uint32_t	GetUsedHeight() const;
+
+            // Consistency checks (for tests): the skyline covers the bin and the waste rects are below it
+            bool        Validate() const;
+            // Whether some part of rRect could be given by Insert (above the skyline or in a waste rect)
+            bool        OverlapsFreeSpace(const Rect &rRect) const;
 
         protected:
+            Rect	    _InsertWasteMap(uint32_t width, uint32_t height);
+            void	    _AddWasteMapArea(int32_t nodeIndex, const Rect &rRect);
+            void	    _AddWasteRect(const Rect &rRect);
+
             Rect	    _InsertBottomLeft(uint32_t width, uint32_t height);
             Rect	    _FindPositionForNewNodeBottomLeft(uint32_t width, uint32_t height, uint32_t *pBestHeight, uint32_t *pBestWidth, int32_t *pBestIndex) const;
             bool	    _RectangleFits(int32_t nodeIndex, uint32_t width, uint32_t height, uint32_t *pY) const;
@@ -70,8 +93,14 @@ namespace MindShake {
 
             void	    _AddSkylineLevel(int32_t nodeIndex, const Rect &rRect);
             void	    _MergeSkylines();
+            void	    _MergeSkylines(int32_t nodeIndex);
+
+            bool        _OverlapsSkyline(const Rect &rRect) const;
 
         protected:
+            static const int32_t kMinWasteSide  = 2;
+            static const int32_t kMaxWasteRects = 64;
+
             // Represents a single level (a horizontal line) of the skyline/horizon/envelope.
             //-------------------------
             struct SkylineNode {
@@ -80,12 +109,14 @@ namespace MindShake {
                 int32_t width;
             };
 
-            std::vector<SkylineNode>	mSkyLine;
+            FontVector<SkylineNode>     mSkyLine;
+            FontVector<Rect>            mWasteMap;
 
             uint32_t		mBinWidth;
             uint32_t		mBinHeight;
             uint32_t		mUsedSurfaceArea;
             bool		    mAllowRotation;
+            bool		    mUseWasteMap;
     };
 
 } // end of namespace
@@ -0,0 +1,124 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "TextCache.h"
+//-------------------------------------
+#include <cstring>
+
+using namespace MindShake;
+
+//-------------------------------------
+TextCache::TextCache(FontAllocator *allocator)
+    : mAllocator(allocator != nullptr ? allocator : FontAllocator::GetDefault())
+    , mTexts(ListText::allocator_type(mAllocator))
+    , mMap(MapText::allocator_type(mAllocator)) {
+}
+
+//-------------------------------------
+void
+TextCache::SetMaxBytes(size_t maxBytes) {
+    mMaxBytes = maxBytes;
+    if(mMaxBytes == 0) {
+        Clear();
+        return;
+    }
+
+    Evict(0);
+}
+
+//-------------------------------------
+// FNV-1a of the string, the height and the config
+uint64_t
+TextCache::GetKey(const char *utf8, size_t length, uint8_t height, uint8_t config) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for(size_t i=0; i<length; ++i) {
+        hash = (hash ^ uint8_t(utf8[i])) * 0x100000001b3ull;
+    }
+    hash = (hash ^ height) * 0x100000001b3ull;
+    hash = (hash ^ config) * 0x100000001b3ull;
+
+    return hash;
+}
+
+//-------------------------------------
+const TextCache::Text *
+TextCache::Find(uint64_t key, const char *utf8, size_t length) {
+    auto it = mMap.find(key);
+    if(it == mMap.end()) {
+        ++mStats.misses;
+        return nullptr;
+    }
+
+    // Another string with the same hash
+    const Text &text = *it->second;
+    if(text.utf8.size() != length || memcmp(text.utf8.data(), utf8, length) != 0) {
+        ++mStats.misses;
+        return nullptr;
+    }
+
+    mTexts.splice(mTexts.begin(), mTexts, it->second);
+    ++mStats.hits;
+
+    return &text;
+}
+
+//-------------------------------------
+const TextCache::Text *
+TextCache::Add(uint64_t key, const char *utf8, size_t length, const FontVector<Glyph> &glyphs, const Rect &box) {
+    size_t bytes = sizeof(Text) + sizeof(MapText::value_type) + 4 * sizeof(void *) + length + 1 + glyphs.size() * sizeof(Glyph);
+    if(bytes > mMaxBytes)
+        return nullptr;
+
+    auto it = mMap.find(key);
+    if(it != mMap.end()) {
+        mStats.bytes -= it->second->bytes;
+        --mStats.numTexts;
+        mTexts.erase(it->second);
+        mMap.erase(it);
+    }
+
+    Evict(bytes);
+
+    mTexts.push_front(Text { key, FontString(utf8, length, FontString::allocator_type(mAllocator)), glyphs, box, bytes });
+    mMap[key] = mTexts.begin();
+    mStats.bytes += bytes;
+    ++mStats.numTexts;
+
+    return &mTexts.front();
+}
+
+//-------------------------------------
+void
+TextCache::Clear() {
+    mTexts.clear();
+    mMap.clear();
+    mStats.bytes    = 0;
+    mStats.numTexts = 0;
+}
+
+//-------------------------------------
+void
+TextCache::ResetStats() {
+    mStats.hits      = 0;
+    mStats.misses    = 0;
+    mStats.evictions = 0;
+}
+
+//-------------------------------------
+// Makes room for bytes more
+void
+TextCache::Evict(size_t bytes) {
+    while(mTexts.empty() == false && mStats.bytes + bytes > mMaxBytes) {
+        const Text &text = mTexts.back();
+        mStats.bytes -= text.bytes;
+        --mStats.numTexts;
+        ++mStats.evictions;
+        mMap.erase(text.key);
+        mTexts.pop_back();
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "FontAllocator.h"
+#include "SkylineBinPack.h"
+//-------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <list>
+
+//-------------------------------------
+namespace MindShake {
+
+    struct CodePointHeightData;
+
+    //---------------------------------
+    // LRU cache of laid out strings: the glyphs to blit, their positions and the text box, keyed by the
+    // string, its height and the render config. Bounded by an approximate number of bytes (0: disabled).
+    // The glyphs point to the glyph cache of the font, so the font clears it whenever it removes glyphs.
+    class TextCache {
+        public:
+            using Rect = SkylineBinPack::Rect;
+
+            struct Glyph {
+                const CodePointHeightData   *data;
+                int32_t                     x, y;   // From the text position (y from the baseline of the first line)
+            };
+
+            struct Text {
+                uint64_t            key;
+                FontString          utf8;
+                FontVector<Glyph>   glyphs;
+                Rect                box;            // As given by GetTextBox
+                size_t              bytes;
+            };
+
+            struct Stats {
+                uint64_t    hits;
+                uint64_t    misses;
+                uint64_t    evictions;
+                uint32_t    numTexts;
+                size_t      bytes;
+
+                double      GetHitRate() const  { return hits + misses != 0 ? double(hits) / double(hits + misses) : 0.0; }
+            };
+
+        public:
+            explicit                    TextCache(FontAllocator *allocator = nullptr);
+
+            void                        SetMaxBytes(size_t maxBytes);       // Shrinking evicts the oldest texts
+            size_t                      GetMaxBytes() const                 { return mMaxBytes;                         }
+            bool                        IsEnabled() const                   { return mMaxBytes != 0;                    }
+
+            static uint64_t             GetKey(const char *utf8, size_t length, uint8_t height, uint8_t config);
+
+            // Makes the text the most recent one. Counts a hit or a miss.
+            const Text *                Find(uint64_t key, const char *utf8, size_t length);
+            // Copies the layout (replacing a text with the same key). Returns nullptr if it does not fit at all.
+            const Text *                Add(uint64_t key, const char *utf8, size_t length, const FontVector<Glyph> &glyphs, const Rect &box);
+            // Keeps the stats
+            void                        Clear();
+
+            Stats                       GetStats() const                    { return mStats;                            }
+            void                        ResetStats();
+
+        protected:
+            using ListText = std::list<Text, StlAllocator<Text>>;
+            using MapText  = FontHashMap<uint64_t, ListText::iterator>;
+
+            void                        Evict(size_t bytes);
+
+        protected:
+            FontAllocator   *mAllocator {};
+            ListText        mTexts;         // Most recent first
+            MapText         mMap;
+            size_t          mMaxBytes {};
+            Stats           mStats {};
+    };
+
+} // end of namespace
@@ -0,0 +1,324 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "TextScene.h"
+//-------------------------------------
+#include <algorithm>
+
+using namespace MindShake;
+
+//-------------------------------------
+TextScene::TextScene(uint32_t width, uint32_t height, uint32_t tileSize) {
+    mTileSize = std::max<uint32_t>(tileSize, 1);
+    Resize(width, height);
+}
+
+//-------------------------------------
+void
+TextScene::Resize(uint32_t width, uint32_t height) {
+    mWidth  = width;
+    mHeight = height;
+    mTilesX = (width  + mTileSize - 1) / mTileSize;
+    mTilesY = (height + mTileSize - 1) / mTileSize;
+    mDamagedTiles.assign(mTilesX * mTilesY, 0);
+
+    Invalidate();
+}
+
+//-------------------------------------
+void
+TextScene::Invalidate() {
+    mFullDamage = true;
+}
+
+//-------------------------------------
+void
+TextScene::Clear() {
+    for(uint32_t id=0; id<mNodes.size(); ++id) {
+        if(mNodes[id].used) {
+            RemoveNode(id);
+        }
+    }
+}
+
+//-------------------------------------
+uint32_t
+TextScene::AddNode(Font *font, const char *utf8, uint8_t textHeight, uint32_t color, int32_t posX, int32_t posY) {
+    uint32_t id;
+
+    if(font == nullptr)
+        return kInvalidNode;
+
+    if(mFreeNodes.empty() == false) {
+        id = mFreeNodes.back();
+        mFreeNodes.pop_back();
+    }
+    else {
+        id = uint32_t(mNodes.size());
+        mNodes.emplace_back();
+    }
+
+    Node &node = mNodes[id];
+    node.font       = font;
+    node.text       = utf8 != nullptr ? utf8 : "";
+    node.textHeight = textHeight;
+    node.color      = color;
+    node.posX       = posX;
+    node.posY       = posY;
+    node.used       = true;
+    node.visible    = true;
+    node.drawn      = false;
+    mDrawOrder.push_back(id);
+    MarkDirty(id);
+
+    return id;
+}
+
+//-------------------------------------
+void
+TextScene::RemoveNode(uint32_t id) {
+    Node *node = GetNode(id);
+    if(node == nullptr)
+        return;
+
+    if(node->drawn) {
+        DamageRect(node->bounds);
+    }
+
+    *node = Node();
+    mFreeNodes.push_back(id);
+    mDrawOrder.erase(std::find(mDrawOrder.begin(), mDrawOrder.end(), id));
+}
+
+//-------------------------------------
+void
+TextScene::SetNodeText(uint32_t id, const char *utf8) {
+    Node *node = GetNode(id);
+    if(node == nullptr)
+        return;
+
+    if(utf8 == nullptr)
+        utf8 = "";
+
+    if(node->text != utf8) {
+        node->text = utf8;
+        MarkDirty(id);
+    }
+}
+
+//-------------------------------------
+void
+TextScene::SetNodePosition(uint32_t id, int32_t posX, int32_t posY) {
+    Node *node = GetNode(id);
+    if(node == nullptr)
+        return;
+
+    if(node->posX != posX || node->posY != posY) {
+        node->posX = posX;
+        node->posY = posY;
+        MarkDirty(id);
+    }
+}
+
+//-------------------------------------
+void
+TextScene::SetNodeHeight(uint32_t id, uint8_t textHeight) {
+    Node *node = GetNode(id);
+    if(node == nullptr)
+        return;
+
+    if(node->textHeight != textHeight) {
+        node->textHeight = textHeight;
+        MarkDirty(id);
+    }
+}
+
+//-------------------------------------
+void
+TextScene::SetNodeColor(uint32_t id, uint32_t color) {
+    Node *node = GetNode(id);
+    if(node == nullptr)
+        return;
+
+    if(node->color != color) {
+        node->color = color;
+        MarkDirty(id);
+    }
+}
+
+//-------------------------------------
+void
+TextScene::SetNodeVisible(uint32_t id, bool visible) {
+    Node *node = GetNode(id);
+    if(node == nullptr)
+        return;
+
+    if(node->visible != visible) {
+        node->visible = visible;
+        MarkDirty(id);
+    }
+}
+
+//-------------------------------------
+bool
+TextScene::Update(uint32_t *dst, uint32_t dstStride) {
+    mDamagedRects.clear();
+    mDamagedBox = {};
+
+    if(mPendingUpdate == false && mFullDamage == false)
+        return false;
+
+    // Old and new bounds of every changed node
+    if(mPendingUpdate) {
+        for(auto &node : mNodes) {
+            if(node.dirty == false)
+                continue;
+
+            if(node.drawn) {
+                DamageRect(node.bounds);
+            }
+
+            node.drawn = node.used && node.visible;
+            if(node.drawn) {
+                node.bounds = ComputeBounds(node);
+                DamageRect(node.bounds);
+            }
+            node.dirty = false;
+        }
+        mPendingUpdate = false;
+    }
+
+    if(mFullDamage) {
+        std::fill(mDamagedTiles.begin(), mDamagedTiles.end(), uint8_t(1));
+        mFullDamage = false;
+    }
+
+    // Merge consecutive damaged tiles of a row into spans
+    int32_t minX = 0x7fffffff, minY = 0x7fffffff;
+    int32_t maxX = 0, maxY = 0;
+    for(uint32_t ty=0; ty<mTilesY; ++ty) {
+        uint8_t *row = &mDamagedTiles[ty * mTilesX];
+        for(uint32_t tx=0; tx<mTilesX; ++tx) {
+            if(row[tx] == 0)
+                continue;
+
+            uint32_t start = tx;
+            while(tx < mTilesX && row[tx] != 0) {
+                row[tx] = 0;
+                ++tx;
+            }
+
+            Rect span;
+            span.x      = int32_t(start * mTileSize);
+            span.y      = int32_t(ty * mTileSize);
+            span.width  = int32_t(std::min(tx * mTileSize, mWidth)) - span.x;
+            span.height = int32_t(std::min((ty + 1) * mTileSize, mHeight)) - span.y;
+            mDamagedRects.push_back(span);
+
+            minX = std::min(minX, span.left());
+            minY = std::min(minY, span.top());
+            maxX = std::max(maxX, span.right());
+            maxY = std::max(maxY, span.bottom());
+        }
+    }
+
+    if(mDamagedRects.empty())
+        return false;
+
+    mDamagedBox = { minX, minY, maxX - minX, maxY - minY };
+
+    for(const auto &span : mDamagedRects) {
+        DrawSpan(span, dst, dstStride);
+    }
+
+    return true;
+}
+
+//-------------------------------------
+TextScene::Node *
+TextScene::GetNode(uint32_t id) {
+    if(id >= mNodes.size() || mNodes[id].used == false)
+        return nullptr;
+
+    return &mNodes[id];
+}
+
+//-------------------------------------
+void
+TextScene::MarkDirty(uint32_t id) {
+    mNodes[id].dirty = true;
+    mPendingUpdate   = true;
+}
+
+//-------------------------------------
+TextScene::Rect
+TextScene::ComputeBounds(const Node &node) const {
+    Rect box { 0, 0, -1, -1 };
+
+    if(node.text.empty() || node.textHeight == 0)
+        return { node.posX, node.posY, 0, 0 };
+
+    node.font->GetTextBox(node.text.c_str(), node.textHeight, &box);
+    if(box.width < box.x || box.height < box.y)
+        return { node.posX, node.posY, 0, 0 };
+
+    // GetTextBox returns the last covered coordinate in width/height
+    return { node.posX + box.x, node.posY + box.y, box.width + 1 - box.x, box.height + 1 - box.y };
+}
+
+//-------------------------------------
+void
+TextScene::DamageRect(const Rect &rect) {
+    if(rect.width <= 0 || rect.height <= 0)
+        return;
+
+    int32_t left   = std::max(rect.left(), 0);
+    int32_t top    = std::max(rect.top(),  0);
+    int32_t right  = std::min(rect.right(),  int32_t(mWidth));
+    int32_t bottom = std::min(rect.bottom(), int32_t(mHeight));
+    if(left >= right || top >= bottom)
+        return;
+
+    uint32_t tx0 = uint32_t(left)  / mTileSize;
+    uint32_t ty0 = uint32_t(top)   / mTileSize;
+    uint32_t tx1 = uint32_t(right  - 1) / mTileSize;
+    uint32_t ty1 = uint32_t(bottom - 1) / mTileSize;
+    for(uint32_t ty=ty0; ty<=ty1; ++ty) {
+        for(uint32_t tx=tx0; tx<=tx1; ++tx) {
+            mDamagedTiles[ty * mTilesX + tx] = 1;
+        }
+    }
+    mPendingUpdate = true;
+}
+
+//-------------------------------------
+void
+TextScene::DrawSpan(const Rect &span, uint32_t *dst, uint32_t dstStride) {
+    int32_t  left, top, right, bottom;
+    uint32_t *line = dst + span.y * dstStride + span.x;
+
+    for(int32_t y=0; y<span.height; ++y) {
+        std::fill(line, line + span.width, mBackgroundColor);
+        line += dstStride;
+    }
+
+    // Nodes are painted in the order they were added, clipped to the span
+    for(uint32_t id : mDrawOrder) {
+        const Node &node = mNodes[id];
+        if(node.drawn == false || node.bounds.width <= 0)
+            continue;
+
+        if(node.bounds.right() <= span.left() || node.bounds.left() >= span.right() ||
+           node.bounds.bottom() <= span.top() || node.bounds.top() >= span.bottom())
+            continue;
+
+        node.font->GetClipping(&left, &top, &right, &bottom);
+        node.font->SetClipping(std::max(left, span.left()), std::max(top, span.top()), std::min(right, span.right()), std::min(bottom, span.bottom()));
+        node.font->DrawText(node.text.c_str(), node.textHeight, node.color, dst, dstStride, node.posX, node.posY);
+        node.font->SetClipping(left, top, right, bottom);
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Copyright (C) 2021 Carlos Aragonés
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt
+//-----------------------------------------------------------------------------
+
+#include "Font.h"
+//-------------------------------------
+#include <cstdint>
+
+//-------------------------------------
+namespace MindShake {
+
+    //---------------------------------
+    // Retained list of text nodes drawn into a buffer of width x height.
+    // Only the tiles covered by nodes that changed since the last Update are
+    // cleared and redrawn, so callers can push just the damaged area to the panel.
+    // Nodes are painted in the order they were added (the last one on top).
+    class TextScene {
+        public:
+            using Rect = SkylineBinPack::Rect;
+
+            static constexpr uint32_t kInvalidNode = 0xffffffff;
+
+        public:
+                                        TextScene(uint32_t width, uint32_t height, uint32_t tileSize = 32);
+
+            void                        Resize(uint32_t width, uint32_t height);
+            void                        Invalidate();                       // Damage the whole buffer
+            void                        Clear();                            // Remove all nodes
+
+            uint32_t                    AddNode(Font *font, const char *utf8, uint8_t textHeight, uint32_t color, int32_t posX, int32_t posY);
+            void                        RemoveNode(uint32_t id);
+
+            void                        SetNodeText(uint32_t id, const char *utf8);
+            void                        SetNodePosition(uint32_t id, int32_t posX, int32_t posY);
+            void                        SetNodeHeight(uint32_t id, uint8_t textHeight);
+            void                        SetNodeColor(uint32_t id, uint32_t color);
+            void                        SetNodeVisible(uint32_t id, bool visible);
+
+            void                        SetBackgroundColor(uint32_t color)  { mBackgroundColor = color; Invalidate(); }
+            uint32_t                    GetBackgroundColor() const          { return mBackgroundColor;                  }
+
+            // Redraws the damaged tiles into dst. Returns false if nothing changed.
+            bool                        Update(uint32_t *dst, uint32_t dstStride);
+
+            // Result of the last Update: union of the damage and the merged tile spans (one per tile row run).
+            const Rect &                GetDamagedBox() const               { return mDamagedBox;                       }
+            const FontVector<Rect> &    GetDamagedRects() const             { return mDamagedRects;                     }
+
+            uint32_t                    GetWidth() const                    { return mWidth;                            }
+            uint32_t                    GetHeight() const                   { return mHeight;                           }
+            uint32_t                    GetTileSize() const                 { return mTileSize;                         }
+
+        protected:
+            struct Node {
+                Font        *font {};
+                FontString  text;
+                Rect        bounds {};          // Screen bounds of the last drawn state
+                int32_t     posX {};
+                int32_t     posY {};
+                uint32_t    color {};
+                uint8_t     textHeight {};
+                bool        used {};
+                bool        visible {};
+                bool        dirty {};
+                bool        drawn {};
+            };
+
+            Node *                      GetNode(uint32_t id);
+            void                        MarkDirty(uint32_t id);
+            Rect                        ComputeBounds(const Node &node) const;
+            void                        DamageRect(const Rect &rect);
+            void                        DrawSpan(const Rect &span, uint32_t *dst, uint32_t dstStride);
+
+        protected:
+            FontVector<Node>        mNodes;
+            FontVector<uint32_t>    mFreeNodes;
+            FontVector<uint32_t>    mDrawOrder;         // Ids in the order they were added (ids are reused)
+            FontVector<uint8_t>     mDamagedTiles;
+            FontVector<Rect>        mDamagedRects;
+            Rect                    mDamagedBox {};
+            uint32_t                mWidth  {};
+            uint32_t                mHeight {};
+            uint32_t                mTileSize {};
+            uint32_t                mTilesX {};
+            uint32_t                mTilesY {};
+            uint32_t                mBackgroundColor { 0xff000000 };
+            bool                    mPendingUpdate {};
+            bool                    mFullDamage {};
+    };
+
+} // end of namespace
@@ -82,6 +82,21 @@ namespace MindShake {
         return codePoint;
     }
 
+    //---------------------------------
+    // Over char text the pointer is advanced through its own type (through a cast const uint8_t ** the compiler
+    // may keep reading the old position: strict aliasing)
+    inline uint32_t
+    GetNextUTF32(const char **text) {
+        if(text == nullptr)
+            return 0;
+
+        const uint8_t *utf8      = reinterpret_cast<const uint8_t *>(*text);
+        uint32_t      codePoint = GetNextUTF32(&utf8);
+        *text = reinterpret_cast<const char *>(utf8);
+
+        return codePoint;
+    }
+
     //---------------------------------
     inline std::string
     UTF32_2_UTF8(const char32_t *utf32) {
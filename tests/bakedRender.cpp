@@ -0,0 +1,68 @@
+#include <FontBaked.h>
+#include <FontSTB.h>
+//-------------------------------------
+#include <cstdio>
+#include <vector>
+//-------------------------------------
+#include "RobotoBaked.h"    // fontBake Roboto-Regular.ttf RobotoBaked.h Roboto 12,20,36 --aa --chars-file tests/bakedChars.txt
+
+//-------------------------------------
+// FontBaked draws the same pixels and measures the same boxes as the font it was baked from.
+//
+// bakedRender [font.ttf]
+//-------------------------------------
+
+static const char       *kTexts[] = {
+    "The quick brown fox\njumps over 0123456789",
+    "AVATAR Tj {[(;:!?)]} Wo.",
+    "\xC3\x81\xC3\x89\xC3\x8D\xC3\x93\xC3\x9A \xC3\xB1\xC3\xA7 \xC2\xBF?",
+};
+static const uint8_t    kHeights[] = { 12, 20, 36 };
+static const uint32_t   kWidth     = 480;
+static const uint32_t   kHeight    = 160;
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    const char *fontName = argc > 1 ? argv[1] : "resources/Roboto-Regular.ttf";
+
+    MindShake::FontSTB font(fontName);
+    if(int8_t(font.GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        return 2;
+    }
+    font.SetAntialias(true);
+
+    MindShake::FontBaked baked(kRobotoFont);
+    std::vector<uint32_t> expected(kWidth * kHeight), result(kWidth * kHeight);
+    int failed = 0;
+
+    for(const char *text : kTexts) {
+        for(uint8_t height : kHeights) {
+            for(int clip = 0; clip < 2; ++clip) {
+                int32_t left = clip ? 40 : 0, top = clip ? 10 : 0, right = clip ? int32_t(kWidth) - 60 : int32_t(kWidth), bottom = clip ? int32_t(kHeight) - 30 : int32_t(kHeight);
+                font.SetClipping(left, top, right, bottom);
+                baked.SetClipping(left, top, right, bottom);
+
+                std::fill(expected.begin(), expected.end(), 0xff202020);
+                std::fill(result.begin(), result.end(), 0xff202020);
+                font.DrawText(text, height, 0xfff0d060, expected.data(), kWidth, clip ? -8 : 4, 4);
+                baked.DrawText(text, height, 0xfff0d060, result.data(), kWidth, clip ? -8 : 4, 4);
+
+                MindShake::FontBaked::Rect fontBox, bakedBox;
+                font.GetTextBox(text, height, &fontBox);
+                baked.GetTextBox(text, height, &bakedBox);
+
+                bool same = expected == result && fontBox.x == bakedBox.x && fontBox.y == bakedBox.y && fontBox.width == bakedBox.width && fontBox.height == bakedBox.height;
+                if(same == false) {
+                    printf("'%s' height %u%s: FAILED\n", text, height, clip ? " clipped" : "");
+                    ++failed;
+                }
+            }
+        }
+    }
+
+    printf("%u baked glyphs, atlas %u x %u: %s\n", baked.GetNumGlyphs(), baked.GetTextureWidth(), baked.GetTextureHeight(), failed ? "FAILED" : "ok");
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+#include <FontSFT.h>
+#include <FontSTB.h>
+//-------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//-------------------------------------
+// Full screen redraws of a 4K terminal with Font::DrawCells, then redraws of the cells changed
+// since the previous frame (checked against a full redraw).
+//
+// benchCells [font.ttf] [height]
+//-------------------------------------
+
+using Cell  = MindShake::Cell;
+using Clock = std::chrono::steady_clock;
+
+static const uint32_t   kWidth  = 3840;
+static const uint32_t   kHeight = 2160;
+static const int        kFrames = 30;
+
+//-------------------------------------
+static uint32_t gSeed = 1;
+
+static uint32_t
+Random(uint32_t range) {
+    gSeed = gSeed * 1664525u + 1013904223u;
+    return (gSeed >> 8) % range;
+}
+
+//-------------------------------------
+static Cell
+RandomCell() {
+    static const uint32_t palette[] = { 0xff000000, 0xffcd3131, 0xff0dbc79, 0xffe5e510, 0xff2472c8, 0xffbc3fbc, 0xff11a8cd, 0xffe5e5e5 };
+
+    Cell cell;
+    cell.codePoint = Random(10) == 0 ? ' ' : 0x21 + Random(0x5E);
+    cell.fg        = palette[1 + Random(7)];
+    cell.bg        = Random(8) == 0 ? palette[Random(8)] : palette[0];
+
+    return cell;
+}
+
+//-------------------------------------
+template <typename FontType>
+static bool
+Run(const char *backend, const char *fontName, uint8_t height) {
+    FontType font(fontName);
+    if(int8_t(font.GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        return false;
+    }
+
+    uint32_t cellWidth, cellHeight;
+    font.GetCellSize(height, &cellWidth, &cellHeight);
+    uint32_t columns = kWidth  / cellWidth;
+    uint32_t rows    = kHeight / cellHeight;
+    font.SetClipping(0, 0, int32_t(kWidth), int32_t(kHeight));
+
+    std::vector<Cell>       cells(size_t(columns) * rows);
+    std::vector<uint32_t>   buffer(size_t(kWidth) * kHeight);
+    std::vector<uint32_t>   reference(buffer.size());
+    for(auto &cell : cells) {
+        cell = RandomCell();
+    }
+
+    // Cold: renders the glyphs
+    font.DrawCells(cells.data(), columns, rows, height, buffer.data(), kWidth, 0, 0);
+
+    auto start = Clock::now();
+    for(int i = 0; i < kFrames; ++i) {
+        font.DrawCells(cells.data(), columns, rows, height, buffer.data(), kWidth, 0, 0);
+    }
+    std::chrono::duration<double, std::milli> full = Clock::now() - start;
+
+    // 1% of the cells change every frame
+    std::vector<Cell> previous;
+    uint64_t          drawn = 0;
+    std::chrono::duration<double, std::milli> partial {};
+    for(int i = 0; i < kFrames; ++i) {
+        previous = cells;
+        for(size_t c = 0; c < cells.size() / 100; ++c) {
+            cells[Random(uint32_t(cells.size()))] = RandomCell();
+        }
+
+        start  = Clock::now();
+        drawn += font.DrawCells(cells.data(), columns, rows, height, buffer.data(), kWidth, 0, 0, previous.data());
+        partial += Clock::now() - start;
+    }
+
+    font.DrawCells(cells.data(), columns, rows, height, reference.data(), kWidth, 0, 0);
+    bool same = buffer == reference;
+
+    printf("%s %3u px  %ux%u cells  full %7.2f ms (%6.1f fps)  changed %6.3f ms (%llu cells)  %s\n",
+           backend, height, columns, rows, full.count() / kFrames, 1000.0 * kFrames / full.count(),
+           partial.count() / kFrames, (unsigned long long) (drawn / kFrames), same ? "ok" : "FAILED (differs from a full redraw)");
+
+    return same;
+}
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    const char  *fontName = "resources/Roboto-Regular.ttf";
+    uint8_t     heights[] = { 12, 16, 24 };
+    uint32_t    numHeights = 3;
+
+    if(argc > 1)
+        fontName = argv[1];
+    if(argc > 2) {
+        heights[0] = uint8_t(atoi(argv[2]));
+        numHeights = 1;
+    }
+
+    bool ok = true;
+    for(uint32_t i = 0; i < numHeights; ++i) {
+        ok &= Run<MindShake::FontSTB>("STB", fontName, heights[i]);
+        ok &= Run<MindShake::FontSFT>("SFT", fontName, heights[i]);
+    }
+
+    return ok ? 0 : 1;
+}
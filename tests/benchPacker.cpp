@@ -0,0 +1,341 @@
+#include <SkylineBinPack.h>
+#include <FontSFT.h>
+#include <FontSTB.h>
+//-------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+//-------------------------------------
+using SkylineBinPack        = MindShake::SkylineBinPack;
+using ELevelChoiceHeuristic = SkylineBinPack::ELevelChoiceHeuristic;
+
+struct Size {
+    int32_t width;
+    int32_t height;
+};
+
+struct Config {
+    const char              *name;
+    ELevelChoiceHeuristic   heuristic;
+    bool                    allowRotation;
+    bool                    useWasteMap;
+    bool                    sorted;         // Tallest first, as a batch insertion
+    bool                    baseline;       // BaselinePacker instead of SkylineBinPack
+};
+
+using Clock = std::chrono::steady_clock;
+
+//-------------------------------------
+static uint32_t gSeed = 1;
+
+static uint32_t
+Random(uint32_t range) {
+    gSeed = gSeed * 1664525u + 1013904223u;
+    return (gSeed >> 8) % range;
+}
+
+//-------------------------------------
+// Glyph like boxes: latin text at several heights (narrow, varied) and CJK (almost square, uniform)
+static std::vector<Size>
+MakeLatin(size_t count) {
+    std::vector<Size> sizes;
+
+    gSeed = 1;
+    for(size_t i = 0; i < count; ++i) {
+        int32_t height = 8 + Random(56);
+        sizes.push_back({ 1 + int32_t(Random(height)), 1 + int32_t(height / 2 + Random(height / 2 + 1)) });
+    }
+
+    return sizes;
+}
+
+static std::vector<Size>
+MakeCJK(size_t count) {
+    std::vector<Size> sizes;
+
+    gSeed = 2;
+    for(size_t i = 0; i < count; ++i) {
+        int32_t height = 16 + 8 * Random(4);
+        sizes.push_back({ height - int32_t(Random(4)), height - int32_t(Random(6)) });
+    }
+
+    return sizes;
+}
+
+//-------------------------------------
+// The skyline packer before the pruned search and the waste map: bottom left only, every node of the skyline is
+// tried and all the levels are merged after each insert. The reference for the speed and the occupancy.
+class BaselinePacker {
+    public:
+        using Rect = SkylineBinPack::Rect;
+
+    public:
+        BaselinePacker(int32_t width, int32_t height, bool, bool) : mBinWidth(width), mBinHeight(height) {
+            mSkyLine.push_back({ 0, 0, width });
+        }
+
+        Rect
+        Insert(int32_t width, int32_t height, ELevelChoiceHeuristic) {
+            int32_t bestIndex  = -1;
+            int32_t bestWidth  = 0x7fffffff;
+            int32_t bestHeight = 0x7fffffff;
+            int32_t y;
+            Rect    rect { 0, 0, 0, 0 };
+
+            for(size_t i = 0; i < mSkyLine.size(); ++i) {
+                if(RectangleFits(i, width, height, &y) == false)
+                    continue;
+                if(y + height < bestHeight || (y + height == bestHeight && mSkyLine[i].width < bestWidth)) {
+                    bestIndex  = int32_t(i);
+                    bestWidth  = mSkyLine[i].width;
+                    bestHeight = y + height;
+                    rect       = { mSkyLine[i].x, y, width, height };
+                }
+            }
+
+            if(bestIndex >= 0) {
+                AddSkylineLevel(size_t(bestIndex), rect);
+            }
+
+            return rect;
+        }
+
+        void
+        ResizeBin(int32_t, int32_t height) {
+            mBinHeight = height;
+        }
+
+        int32_t
+        GetHeight() const {
+            return mBinHeight;
+        }
+
+        int32_t
+        GetUsedHeight() const {
+            int32_t height = 0;
+            for(const auto &node : mSkyLine) {
+                height = std::max(height, node.y);
+            }
+            return height;
+        }
+
+    protected:
+        struct Node {
+            int32_t x;
+            int32_t y;
+            int32_t width;
+        };
+
+        bool
+        RectangleFits(size_t index, int32_t width, int32_t height, int32_t *pY) const {
+            if(mSkyLine[index].x + width > mBinWidth)
+                return false;
+
+            int32_t widthLeft = width;
+            *pY = mSkyLine[index].y;
+            for(size_t i = index; widthLeft > 0; ++i) {
+                *pY = std::max(*pY, mSkyLine[i].y);
+                if(*pY + height > mBinHeight)
+                    return false;
+                widthLeft -= mSkyLine[i].width;
+            }
+
+            return true;
+        }
+
+        void
+        AddSkylineLevel(size_t index, const Rect &rect) {
+            mSkyLine.insert(mSkyLine.begin() + index, { rect.x, rect.y + rect.height, rect.width });
+
+            for(size_t i = index + 1; i < mSkyLine.size(); ++i) {
+                int32_t shrink = mSkyLine[i - 1].x + mSkyLine[i - 1].width - mSkyLine[i].x;
+                if(shrink <= 0)
+                    break;
+
+                mSkyLine[i].x     += shrink;
+                mSkyLine[i].width -= shrink;
+                if(mSkyLine[i].width > 0)
+                    break;
+
+                mSkyLine.erase(mSkyLine.begin() + i);
+                --i;
+            }
+
+            for(size_t i = 0; i + 1 < mSkyLine.size(); ++i) {
+                if(mSkyLine[i].y == mSkyLine[i + 1].y) {
+                    mSkyLine[i].width += mSkyLine[i + 1].width;
+                    mSkyLine.erase(mSkyLine.begin() + i + 1);
+                    --i;
+                }
+            }
+        }
+
+    protected:
+        std::vector<Node>   mSkyLine;
+        int32_t             mBinWidth;
+        int32_t             mBinHeight;
+};
+
+//-------------------------------------
+// The bin starts at 128 rows and doubles its height when full (as the atlas pages do)
+template <typename Packer>
+static void
+Run(const char *setName, const std::vector<Size> &sizes, const Config &config) {
+    const int32_t   binWidth     = 1024;
+    const int32_t   maxBinHeight = 0x10000;
+    const int       rounds       = 5;
+
+    uint64_t    area   = 0;
+    size_t      placed = 0;
+    int32_t     binHeight  = 0;
+    int32_t     usedHeight = 0;
+    double      bestMs = 1e30;
+
+    for(int round = 0; round < rounds; ++round) {
+        Packer packer(binWidth, 128, config.allowRotation, config.useWasteMap);
+
+        area   = 0;
+        placed = 0;
+        auto start = Clock::now();
+        std::vector<Size> batch;
+        if(config.sorted) {
+            batch = sizes;
+            std::sort(batch.begin(), batch.end(), [](const Size &a, const Size &b) {
+                return a.height != b.height ? a.height > b.height : a.width > b.width;
+            });
+        }
+        for(const auto &size : config.sorted ? batch : sizes) {
+            SkylineBinPack::Rect rect = packer.Insert(size.width, size.height, config.heuristic);
+            while(rect.width <= 0 && packer.GetHeight() < maxBinHeight) {
+                packer.ResizeBin(binWidth, packer.GetHeight() * 2);
+                rect = packer.Insert(size.width, size.height, config.heuristic);
+            }
+            if(rect.width <= 0)
+                break;
+
+            area += uint64_t(size.width) * size.height;
+            ++placed;
+        }
+        std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+
+        if(bestMs > elapsed.count())
+            bestMs = elapsed.count();
+        binHeight  = packer.GetHeight();
+        usedHeight = packer.GetUsedHeight();
+    }
+
+    // Occupancy of the used rows and of the whole bin (texture memory)
+    printf("%-6s %-24s placed %6zu  used %6d/%6d  occupancy %5.1f%% (bin %5.1f%%)  %8.2f ms  %6.2f Minserts/s\n",
+           setName, config.name, placed, usedHeight, binHeight,
+           100.0 * double(area) / (double(binWidth) * usedHeight),
+           100.0 * double(area) / (double(binWidth) * binHeight),
+           bestMs, placed / (bestMs * 1000.0));
+}
+
+//-------------------------------------
+static void
+AppendUTF8(std::string &text, uint32_t codePoint) {
+    if(codePoint < 0x80) {
+        text += char(codePoint);
+    }
+    else if(codePoint < 0x800) {
+        text += char(0xC0 | (codePoint >> 6));
+        text += char(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        text += char(0xE0 | (codePoint >> 12));
+        text += char(0x80 | ((codePoint >> 6) & 0x3F));
+        text += char(0x80 | (codePoint & 0x3F));
+    }
+}
+
+//-------------------------------------
+// Warming a character set at 3 sizes: glyph by glyph (as DrawText does) or with PreloadGlyphs
+template <typename FontType>
+static void
+RunFont(const char *fontName, const char *backend) {
+    const uint8_t   heights[] = { 16, 32, 48 };
+    std::string     text;
+
+    // Latin-1, Latin Extended-A, Greek and Cyrillic
+    for(uint32_t cp = 0x21; cp < 0x7F; ++cp)    AppendUTF8(text, cp);
+    for(uint32_t cp = 0xA1; cp < 0x180; ++cp)   AppendUTF8(text, cp);
+    for(uint32_t cp = 0x391; cp < 0x3CA; ++cp)  AppendUTF8(text, cp);
+    for(uint32_t cp = 0x410; cp < 0x450; ++cp)  AppendUTF8(text, cp);
+
+    for(int batch = 0; batch < 2; ++batch) {
+        std::unique_ptr<FontType>   font;
+        double                      bestMs = 1e30;
+
+        for(int round = 0; round < 5; ++round) {
+            font = std::make_unique<FontType>(fontName);
+            if(int8_t(font->GetStatus()) < 0)
+                return;
+
+            auto start = Clock::now();
+            if(batch) {
+                font->PreloadGlyphs(text.c_str(), heights, 3);
+            }
+            else {
+                for(uint8_t height : heights) {
+                    font->GetTextBox(text.c_str(), height, nullptr);
+                }
+            }
+            std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+
+            if(bestMs > elapsed.count())
+                bestMs = elapsed.count();
+        }
+
+        auto stats = font->GetAtlas()->GetStats();
+        printf("%-4s %-12s glyphs %5u  pages %u  used %7llu/%7llu bytes  occupancy %5.1f%% (texture %5.1f%%)  %8.2f ms\n",
+               backend, batch ? "preload" : "incremental", stats.numRegions, stats.numPages,
+               (unsigned long long) stats.usedBytes, (unsigned long long) stats.textureBytes,
+               100.0 * double(stats.liveArea) / double(stats.usedBytes), 100.0 * font->GetAtlas()->GetOccupancy(), bestMs);
+    }
+}
+
+//-------------------------------------
+// benchPacker [count] [font.ttf]
+int
+main(int argc, char *argv[]) {
+    const Config configs[] = {
+        { "BottomLeft baseline",    ELevelChoiceHeuristic::LevelBottomLeft,  false, false, false, true  },
+        { "BottomLeft",             ELevelChoiceHeuristic::LevelBottomLeft,  false, false, false, false },
+        { "BottomLeft+rot",         ELevelChoiceHeuristic::LevelBottomLeft,  true,  false, false, false },
+        { "BottomLeft+waste",       ELevelChoiceHeuristic::LevelBottomLeft,  false, true,  false, false },
+        { "BottomLeft+rot+waste",   ELevelChoiceHeuristic::LevelBottomLeft,  true,  true,  false, false },
+        { "BottomLeft sorted",      ELevelChoiceHeuristic::LevelBottomLeft,  false, false, true,  false },
+        { "BottomLeft+waste sorted",ELevelChoiceHeuristic::LevelBottomLeft,  false, true,  true,  false },
+        { "MinWaste",               ELevelChoiceHeuristic::LevelMinWasteFit, false, false, false, false },
+        { "MinWaste+rot+waste",     ELevelChoiceHeuristic::LevelMinWasteFit, true,  true,  false, false },
+        { "MinWaste sorted",        ELevelChoiceHeuristic::LevelMinWasteFit, false, false, true,  false },
+    };
+
+    size_t count = 20000;
+    if(argc > 1) {
+        count = size_t(strtoul(argv[1], nullptr, 10));
+    }
+
+    const std::vector<Size> latin = MakeLatin(count);
+    const std::vector<Size> cjk   = MakeCJK(count);
+
+    for(const auto &config : configs) {
+        (config.baseline ? Run<BaselinePacker> : Run<SkylineBinPack>)("latin", latin, config);
+    }
+    for(const auto &config : configs) {
+        (config.baseline ? Run<BaselinePacker> : Run<SkylineBinPack>)("cjk", cjk, config);
+    }
+
+    if(argc > 2) {
+        RunFont<MindShake::FontSTB>(argv[2], "STB");
+        RunFont<MindShake::FontSFT>(argv[2], "SFT");
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <FontACC.h>
+#include <FontSFT.h>
+#include <FontSTB.h>
+#include <ScratchArena.h>
+//-------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//-------------------------------------
+// Cold glyph cost of each backend: glyphs rasterized per second at several heights (without atlas nor antialias),
+// and how far the accumulation rasterizer (FontACC) is from stb_truetype, pixel by pixel.
+//
+// benchRaster [font.ttf] [seconds per case]
+//-------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+//-------------------------------------
+// Access to the glyph miss path of the font, without the atlas
+template <typename FontType>
+class RasterBench : public FontType {
+    public:
+        explicit RasterBench(const char *fontName) : FontType(fontName) { }
+
+        // Returns the number of glyphs rasterized. The bitmaps are appended to pPixels if given.
+        uint32_t
+        Rasterize(const std::vector<uint32_t> &codePoints, uint8_t height, std::vector<uint8_t> *pPixels) {
+            uint32_t count = 0;
+
+            for(uint32_t codePoint : codePoints) {
+                typename FontType::GlyphBox box;
+                if(this->MeasureGlyph(codePoint, height, &box) == false)
+                    continue;
+
+                MindShake::ScratchScope scratch;
+                const uint8_t *pixels = this->RasterizeGlyph(box, height);
+                if(pixels == nullptr)
+                    continue;
+
+                if(pPixels != nullptr)
+                    pPixels->insert(pPixels->end(), pixels, pixels + box.width * box.height);
+                ++count;
+            }
+
+            return count;
+        }
+};
+
+//-------------------------------------
+template <typename FontType>
+static double
+MeasureGlyphsPerSecond(const char *fontName, const std::vector<uint32_t> &codePoints, uint8_t height, double seconds, std::vector<uint8_t> *pPixels) {
+    RasterBench<FontType> font(fontName);
+    if(int8_t(font.GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        exit(2);
+    }
+
+    // Warm up: the outlines parsed once (FontSTB, FontACC) and the scratch memory
+    font.Rasterize(codePoints, height, pPixels);
+
+    uint64_t glyphs = 0;
+    auto     start  = Clock::now();
+    std::chrono::duration<double> elapsed {};
+    do {
+        glyphs += font.Rasterize(codePoints, height, nullptr);
+        elapsed = Clock::now() - start;
+    } while(elapsed.count() < seconds);
+
+    return double(glyphs) / elapsed.count();
+}
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    const uint8_t   heights[] = { 12, 24, 48, 96, 192 };
+    const char      *fontName = argc > 1 ? argv[1] : "resources/Roboto-Regular.ttf";
+    double          seconds   = argc > 2 ? atof(argv[2]) : 0.5;
+
+    // Printable ASCII and Latin-1
+    std::vector<uint32_t> codePoints;
+    for(uint32_t codePoint = 0x21; codePoint < 0x100; ++codePoint) {
+        if(codePoint < 0x7f || codePoint > 0xa0)
+            codePoints.push_back(codePoint);
+    }
+
+    printf("%u code points\n", uint32_t(codePoints.size()));
+    printf("height    stb glyphs/s    sft glyphs/s    acc glyphs/s   acc / stb   acc vs stb: mean diff  max diff\n");
+    for(uint8_t height : heights) {
+        std::vector<uint8_t> stbPixels, accPixels;
+
+        double stb = MeasureGlyphsPerSecond<MindShake::FontSTB>(fontName, codePoints, height, seconds, &stbPixels);
+        double sft = MeasureGlyphsPerSecond<MindShake::FontSFT>(fontName, codePoints, height, seconds, nullptr);
+        double acc = MeasureGlyphsPerSecond<MindShake::FontACC>(fontName, codePoints, height, seconds, &accPixels);
+
+        // Same boxes (both come from stb_truetype)
+        double  sum     = 0.0;
+        int32_t maxDiff = 0;
+        size_t  count   = std::min(stbPixels.size(), accPixels.size());
+        for(size_t i = 0; i < count; ++i) {
+            int32_t diff = std::abs(int32_t(stbPixels[i]) - int32_t(accPixels[i]));
+            sum    += diff;
+            maxDiff = std::max(maxDiff, diff);
+        }
+
+        printf("%6u  %14.0f  %14.0f  %14.0f  %9.2fx  %20.3f  %8d\n", height, stb, sft, acc, acc / stb, count != 0 ? sum / double(count) : 0.0, maxDiff);
+    }
+
+    return 0;
+}
@@ -264,15 +264,11 @@ main(int argc, char *argv[]) {
                 case KB_KEY_A:
                     fontSFT.SetAntialias(!fontSFT.GetAntialias());
                     fontSTB.SetAntialias(!fontSTB.GetAntialias());
-                    fontSFT.Reset();
-                    fontSTB.Reset();
                     break;
 
                 case KB_KEY_E:
                     fontSFT.SetAntialiasAllowEx(!fontSFT.GetAntialiasAllowEx());
                     fontSTB.SetAntialiasAllowEx(!fontSTB.GetAntialiasAllowEx());
-                    fontSFT.Reset();
-                    fontSTB.Reset();
                     break;
 
                 case KB_KEY_TAB:
@@ -0,0 +1,142 @@
+#include <FontBaker.h>
+#include <FontSFT.h>
+#include <FontSTB.h>
+//-------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+//-------------------------------------
+// Bakes a font into a C++ header for FontBaked (no font parsing nor rasterization at startup).
+//
+// fontBake <font.ttf> <output.h> <name> <heights> [options]
+//   heights            comma separated (e.g. 12,16,24)
+//   --chars <utf8>     code points to bake (default: printable ASCII)
+//   --chars-file <f>   code points to bake, read from a UTF-8 file
+//   --sft              render with libschrift (default: stb_truetype)
+//   --aa / --aaex      antialias (AABlock / AABlockEx)
+//   --width <w>        atlas width (default 512)
+//-------------------------------------
+
+//-------------------------------------
+static bool
+ReadFile(const char *fileName, std::string *pText) {
+    FILE *file = fopen(fileName, "rb");
+    if(file == nullptr)
+        return false;
+
+    char   buffer[4096];
+    size_t size;
+    while((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        pText->append(buffer, size);
+    }
+    fclose(file);
+
+    return true;
+}
+
+//-------------------------------------
+static int
+Usage() {
+    fprintf(stderr, "fontBake <font.ttf> <output.h> <name> <heights> [--chars <utf8>] [--chars-file <file>] [--sft] [--aa | --aaex] [--width <w>]\n");
+    return 2;
+}
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    std::vector<uint8_t>    heights;
+    std::string             chars;
+    uint32_t                width = 512;
+    bool                    useSFT = false;
+    bool                    useAA = false;
+    bool                    useAAEx = false;
+
+    if(argc < 5)
+        return Usage();
+
+    const char *fontName   = argv[1];
+    const char *outputName = argv[2];
+    const char *name       = argv[3];
+
+    for(const char *height = argv[4]; *height != 0; ) {
+        char *end;
+        long value = strtol(height, &end, 10);
+        if(end == height || value <= 0 || value > 255)
+            return Usage();
+        heights.push_back(uint8_t(value));
+        height = *end == ',' ? end + 1 : end;
+    }
+
+    for(int i = 5; i < argc; ++i) {
+        if(strcmp(argv[i], "--chars") == 0 && i + 1 < argc) {
+            chars += argv[++i];
+        }
+        else if(strcmp(argv[i], "--chars-file") == 0 && i + 1 < argc) {
+            if(ReadFile(argv[++i], &chars) == false) {
+                fprintf(stderr, "Can't read '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--sft") == 0) {
+            useSFT = true;
+        }
+        else if(strcmp(argv[i], "--aa") == 0) {
+            useAA = true;
+        }
+        else if(strcmp(argv[i], "--aaex") == 0) {
+            useAA   = true;
+            useAAEx = true;
+        }
+        else if(strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            width = uint32_t(strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            return Usage();
+        }
+    }
+
+    if(chars.empty()) {
+        for(char c = 0x20; c < 0x7f; ++c) {
+            chars += c;
+        }
+    }
+
+    std::unique_ptr<MindShake::Font> font;
+    if(useSFT)
+        font.reset(new MindShake::FontSFT(fontName));
+    else
+        font.reset(new MindShake::FontSTB(fontName));
+
+    if(int8_t(font->GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        return 1;
+    }
+    font->SetAntialias(useAA);
+    font->SetAntialiasAllowEx(useAAEx);
+
+    MindShake::FontBaker baker;
+    if(baker.Bake(*font, chars.c_str(), heights.data(), uint32_t(heights.size()), width) == false)
+        return 1;
+
+    FILE *file = fopen(outputName, "wb");
+    if(file == nullptr) {
+        fprintf(stderr, "Can't write '%s'\n", outputName);
+        return 1;
+    }
+
+    std::string comment = std::string(fontName) + (useSFT ? " (libschrift" : " (stb_truetype") + (useAAEx ? ", antialias ex)" : useAA ? ", antialias)" : ")");
+    bool ok = baker.WriteHeader(file, name, comment.c_str());
+    ok &= fclose(file) == 0;
+    if(ok == false) {
+        fprintf(stderr, "Can't write '%s'\n", outputName);
+        return 1;
+    }
+
+    printf("%s: %u glyphs, %u kerning pairs, atlas %u x %u\n", outputName, baker.GetNumGlyphs(), baker.GetNumKernings(), baker.GetAtlasWidth(), baker.GetAtlasHeight());
+
+    return 0;
+}
@@ -0,0 +1,799 @@
+#include <FontACC.h>
+#include <FontCollection.h>
+#include <FontSFT.h>
+#include <FontSTB.h>
+#include <TextScene.h>
+//-------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//-------------------------------------
+// Renders fixed strings in memory with every backend (sizes x antialias modes x clipping)
+// and compares them with the golden images (binary PPM). A missing golden is a failure:
+// --update records (or rewrites) them. Failing cases leave goldenDir/<case>.actual.ppm.
+// Each backend, size and antialias mode also runs the feature checks (text cache, effects, measure, fit, face, collection,
+// scene, frozen allocator and the FontACC coverage), which name the feature that fails and don't need the goldens.
+// The goldens are made with tests/resources/Lato-Regular.ttf (kept in git, not in git lfs).
+// Exits with kSkipped when the font is only a git LFS pointer (git lfs pull).
+//
+// goldenRender [--update] [font.ttf] [goldenDir]
+//-------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+enum class AAMode {
+    None,
+    AA,
+    AAEx,
+};
+
+struct Image {
+    uint32_t                width;
+    uint32_t                height;
+    std::vector<uint32_t>   pixels;     // 0xAARRGGBB
+};
+
+//-------------------------------------
+static const char       *kText      = "The quick brown fox\njumps over 0123456789\n\xC3\x81\xC3\x89\xC3\x8D\xC3\x93\xC3\x9A \xC3\xB1\xC3\xA7 AVATAR Tj {[(;:!?)]}";
+static const uint32_t   kColor      = 0xfff0d060;
+static const uint32_t   kBackground = 0xff102030;
+static const uint32_t   kWidth      = 480;
+
+// Tolerance: channel difference per pixel and pixels allowed beyond it
+static const int32_t    kMaxChannelDiff = 2;
+static const double     kMaxBadPixels   = 0.0005;
+
+// ctest SKIP_RETURN_CODE
+static const int        kSkipped = 77;
+
+//-------------------------------------
+static bool
+IsLfsPointer(const char *fileName) {
+    const char  prefix[] = "version https://git-lfs";
+    char        buffer[sizeof(prefix) - 1];
+
+    FILE *file = fopen(fileName, "rb");
+    if(file == nullptr)
+        return false;
+    bool isPointer = fread(buffer, 1, sizeof(buffer), file) == sizeof(buffer) && memcmp(buffer, prefix, sizeof(buffer)) == 0;
+    fclose(file);
+
+    return isPointer;
+}
+
+//-------------------------------------
+static bool
+WritePPM(const std::string &fileName, const Image &image) {
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if(file == nullptr) {
+        fprintf(stderr, "Can't write '%s'\n", fileName.c_str());
+        return false;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", image.width, image.height);
+    std::vector<uint8_t> row(image.width * 3);
+    for(uint32_t y = 0; y < image.height; ++y) {
+        for(uint32_t x = 0; x < image.width; ++x) {
+            uint32_t color = image.pixels[y * image.width + x];
+            row[x * 3 + 0] = uint8_t(color >> 16);
+            row[x * 3 + 1] = uint8_t(color >> 8);
+            row[x * 3 + 2] = uint8_t(color);
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    fclose(file);
+
+    return true;
+}
+
+//-------------------------------------
+static bool
+ReadPPM(const std::string &fileName, Image *pImage) {
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if(file == nullptr)
+        return false;
+
+    uint32_t width, height, maxValue;
+    if(fscanf(file, "P6 %u %u %u", &width, &height, &maxValue) != 3 || maxValue != 255 || fgetc(file) == EOF) {
+        fclose(file);
+        return false;
+    }
+
+    std::vector<uint8_t> rgb(size_t(width) * height * 3);
+    bool ok = fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    fclose(file);
+    if(ok == false)
+        return false;
+
+    pImage->width  = width;
+    pImage->height = height;
+    pImage->pixels.resize(size_t(width) * height);
+    for(size_t i = 0; i < pImage->pixels.size(); ++i) {
+        pImage->pixels[i] = 0xff000000 | (uint32_t(rgb[i * 3]) << 16) | (uint32_t(rgb[i * 3 + 1]) << 8) | rgb[i * 3 + 2];
+    }
+
+    return true;
+}
+
+//-------------------------------------
+// Returns the number of pixels with some channel beyond the tolerance (or -1 if the sizes differ)
+static int64_t
+Compare(const Image &a, const Image &b, int32_t *pMaxDiff) {
+    if(a.width != b.width || a.height != b.height)
+        return -1;
+
+    int64_t bad     = 0;
+    int32_t maxDiff = 0;
+    for(size_t i = 0; i < a.pixels.size(); ++i) {
+        int32_t diff = 0;
+        for(int shift = 0; shift < 24; shift += 8) {
+            int32_t channel = std::abs(int32_t((a.pixels[i] >> shift) & 0xff) - int32_t((b.pixels[i] >> shift) & 0xff));
+            if(diff < channel)
+                diff = channel;
+        }
+        if(maxDiff < diff)
+            maxDiff = diff;
+        if(diff > kMaxChannelDiff)
+            ++bad;
+    }
+    *pMaxDiff = maxDiff;
+
+    return bad;
+}
+
+//-------------------------------------
+static const char *
+GetAAName(AAMode mode) {
+    switch(mode) {
+        case AAMode::None:  return "noaa";
+        case AAMode::AA:    return "aa";
+        case AAMode::AAEx:  return "aaex";
+    }
+    return "";
+}
+
+//-------------------------------------
+static Image
+NewImage(uint8_t size) {
+    Image image;
+    image.width  = kWidth;
+    image.height = uint32_t(size) * 4 + 8;
+    image.pixels.assign(size_t(image.width) * image.height, kBackground);
+
+    return image;
+}
+
+//-------------------------------------
+// Each case uses a new font: the first draw renders every glyph (cold), the next ones only blit (warm)
+template <typename FontType>
+static bool
+RunCase(const char *backend, const char *fontName, const std::string &goldenDir, bool update, uint8_t size, AAMode aa, bool clip, int *pFailed) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s_%u_%s%s", backend, size, GetAAName(aa), clip ? "_clip" : "");
+
+    FontType font(fontName);
+    if(int8_t(font.GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        return false;
+    }
+    font.SetAntialias(aa != AAMode::None);
+    font.SetAntialiasAllowEx(aa == AAMode::AAEx);
+
+    Image image = NewImage(size);
+
+    // Clipped cases cut every side and start left of the buffer
+    int32_t posX = 4;
+    if(clip) {
+        font.SetClipping(int32_t(kWidth / 8), int32_t(size / 2), int32_t(kWidth - kWidth / 4), int32_t(image.height - size));
+        posX = -int32_t(size);
+    }
+    else {
+        font.SetClipping(0, 0, int32_t(image.width), int32_t(image.height));
+    }
+
+    auto start = Clock::now();
+    font.DrawText(kText, size, kColor, image.pixels.data(), image.width, posX, 4);
+    std::chrono::duration<double, std::milli> cold = Clock::now() - start;
+
+    // The golden is a warm draw (the glyphs are only blitted)
+    const int rounds = 20;
+    start = Clock::now();
+    for(int i = 0; i < rounds; ++i) {
+        std::fill(image.pixels.begin(), image.pixels.end(), kBackground);
+        font.DrawText(kText, size, kColor, image.pixels.data(), image.width, posX, 4);
+    }
+    std::chrono::duration<double, std::micro> warm = Clock::now() - start;
+
+    // The same with the laid out text cached
+    Image cachedImage = image;
+    font.SetTextCacheSize(64 << 10);
+    font.DrawText(kText, size, kColor, cachedImage.pixels.data(), cachedImage.width, posX, 4);
+    start = Clock::now();
+    for(int i = 0; i < rounds; ++i) {
+        std::fill(cachedImage.pixels.begin(), cachedImage.pixels.end(), kBackground);
+        font.DrawText(kText, size, kColor, cachedImage.pixels.data(), cachedImage.width, posX, 4);
+    }
+    std::chrono::duration<double, std::micro> cached = Clock::now() - start;
+
+    std::string goldenName = goldenDir + "/" + name + ".ppm";
+    Image       golden;
+    const char  *result;
+    int32_t     maxDiff = 0;
+    if(update) {
+        result = "updated";
+        if(WritePPM(goldenName, image) == false) {
+            result = "CAN'T WRITE";
+            ++(*pFailed);
+        }
+    }
+    else if(ReadPPM(goldenName, &golden) == false) {
+        result = "MISSING (record it with --update)";
+        WritePPM(goldenDir + "/" + name + ".actual.ppm", image);
+        ++(*pFailed);
+    }
+    else {
+        int64_t bad = Compare(image, golden, &maxDiff);
+        if(bad < 0 || double(bad) > kMaxBadPixels * double(image.pixels.size())) {
+            result = bad < 0 ? "FAILED (size)" : "FAILED";
+            WritePPM(goldenDir + "/" + name + ".actual.ppm", image);
+            ++(*pFailed);
+        }
+        else {
+            result = "ok";
+        }
+    }
+
+    printf("%-22s cold %8.3f ms  warm %9.2f us  cached %9.2f us  max diff %3d  %s\n", name, cold.count(), warm.count() / rounds, cached.count() / rounds, maxDiff, result);
+
+    return true;
+}
+
+//-------------------------------------
+// Feature checks: each one gets a new font with the antialias mode of the case, clipped to an image of NewImage,
+// and returns what went wrong (empty if nothing). They don't depend on the goldens.
+template <typename FontType>
+using CheckFunction = std::string (*)(FontType &font, uint8_t size);
+
+//-------------------------------------
+// The laid out text drawn from the text cache gives the same pixels
+template <typename FontType>
+static std::string
+CheckTextCache(FontType &font, uint8_t size) {
+    Image drawn = NewImage(size), cached = NewImage(size);
+    font.DrawText(kText, size, kColor, drawn.pixels.data(), drawn.width, 4, 4);
+
+    // The first draw fills the cache, the second one hits it
+    font.SetTextCacheSize(64 << 10);
+    for(int i = 0; i < 2; ++i) {
+        std::fill(cached.pixels.begin(), cached.pixels.end(), kBackground);
+        font.DrawText(kText, size, kColor, cached.pixels.data(), cached.width, 4, 4);
+    }
+    if(font.GetTextCacheStats().hits == 0)
+        return "the text was not cached";
+    if(cached.pixels != drawn.pixels)
+        return "the cached text draws different pixels";
+
+    return "";
+}
+
+//-------------------------------------
+// A hard shadow (radius 0) is the text drawn twice, and the variants of the other effects match a new rasterization
+template <typename FontType>
+static std::string
+CheckEffects(FontType &font, uint8_t size) {
+    const MindShake::TextEffect shadow { MindShake::ETextEffect::Shadow, 0, 0xc0000000, 2, 3 };
+    Image effectImage = NewImage(size), twiceImage = NewImage(size);
+    font.DrawText(kText, size, kColor, shadow, effectImage.pixels.data(), effectImage.width, 4, 4);
+    font.DrawText(kText, size, shadow.color, twiceImage.pixels.data(), twiceImage.width, 4 + shadow.offsetX, 4 + shadow.offsetY);
+    font.DrawText(kText, size, kColor, twiceImage.pixels.data(), twiceImage.width, 4, 4);
+    if(effectImage.pixels != twiceImage.pixels)
+        return "a hard shadow is not the text drawn twice";
+
+    for(auto type : { MindShake::ETextEffect::Outline, MindShake::ETextEffect::Shadow, MindShake::ETextEffect::Glow }) {
+        font.DrawText(kText, size, kColor, { type, uint8_t(size / 12 + 1), 0xff000000, 1, 1 }, effectImage.pixels.data(), effectImage.width, 4, 4);
+    }
+    if(font.Validate() == false)
+        return "the effect variants differ from a new rasterization (see stderr)";
+
+    return "";
+}
+
+//-------------------------------------
+// Coverage close to stb_truetype's (FontACC: same glyph boxes, another rasterizer). A mean difference of a few
+// levels over the glyph pixels is the flattening; a broken rasterizer is far beyond it.
+template <typename FontType>
+static std::string
+CheckCoverage(FontType &font, uint8_t size) {
+    const double kMaxMeanDiff = 6.0;
+
+    MindShake::FontSTB reference(font.GetFace());
+    int32_t left, top, right, bottom;
+    font.GetClipping(&left, &top, &right, &bottom);
+    reference.SetClipping(left, top, right, bottom);
+    reference.SetAntialias(font.GetAntialias());
+    reference.SetAntialiasAllowEx(font.GetAntialiasAllowEx());
+
+    Image image = NewImage(size), referenceImage = NewImage(size);
+    font.DrawText(kText, size, kColor, image.pixels.data(), image.width, 4, 4);
+    reference.DrawText(kText, size, kColor, referenceImage.pixels.data(), referenceImage.width, 4, 4);
+
+    double sum   = 0.0;
+    size_t count = 0;
+    for(size_t i = 0; i < image.pixels.size(); ++i) {
+        if(image.pixels[i] == kBackground && referenceImage.pixels[i] == kBackground)
+            continue;
+        sum += std::abs(int32_t((image.pixels[i] >> 16) & 0xff) - int32_t((referenceImage.pixels[i] >> 16) & 0xff));   // Red: the widest range
+        ++count;
+    }
+    if(count == 0 || sum / double(count) > kMaxMeanDiff)
+        return "the coverage is far from stb_truetype's";
+
+    return "";
+}
+
+//-------------------------------------
+// Measuring (alone or in a batch) gives the box of the laid out text (text cache) without adding glyphs to the atlas
+template <typename FontType>
+static std::string
+CheckMeasure(FontType &font, uint8_t size) {
+    using Rect = MindShake::SkylineBinPack::Rect;
+
+    const char  *batch[] = { "AVATAR", kText, "Tj", "" };
+    const auto  numTexts = uint32_t(sizeof(batch) / sizeof(batch[0]));
+    Image       image    = NewImage(size);
+    Rect        drawnBoxes[numTexts], boxes[numTexts], batchBoxes[numTexts];
+
+    font.SetTextCacheSize(64 << 10);
+    for(uint32_t i = 0; i < numTexts; ++i) {
+        font.DrawText(batch[i], size, kColor, image.pixels.data(), image.width, 4, 4);
+        font.GetTextBox(batch[i], size, &drawnBoxes[i]);
+    }
+
+    FontType measureFont(font.GetFace());
+    measureFont.SetAntialias(font.GetAntialias());
+    measureFont.SetAntialiasAllowEx(font.GetAntialiasAllowEx());
+    measureFont.ConsumeDirtyRegions();
+    for(uint32_t i = 0; i < numTexts; ++i) {
+        measureFont.GetTextBox(batch[i], size, &boxes[i]);
+    }
+    measureFont.GetTextBoxes(batch, numTexts, size, batchBoxes, 2);
+
+    if(measureFont.ConsumeDirtyRegions().empty() == false)
+        return "measuring added glyphs to the atlas";
+    if(memcmp(drawnBoxes, boxes, sizeof(boxes)) != 0)
+        return "GetTextBox differs from the laid out text";
+    if(memcmp(boxes, batchBoxes, sizeof(boxes)) != 0)
+        return "GetTextBoxes differs from GetTextBox";
+
+    return "";
+}
+
+//-------------------------------------
+// A fitted text draws the same as its truncated string, within the width
+template <typename FontType>
+static std::string
+CheckFit(FontType &font, uint8_t size) {
+    const int32_t maxWidth = int32_t(size) * 4;
+
+    for(auto mode : { MindShake::ETruncate::End, MindShake::ETruncate::Middle, MindShake::ETruncate::Start }) {
+        MindShake::TextFit fit;
+        Image fitImage = NewImage(size), stringImage = NewImage(size);
+        int32_t width = font.DrawTextFit(kText, size, maxWidth, mode, kColor, fitImage.pixels.data(), fitImage.width, 4, 4);
+        if(font.MeasureFit(kText, size, maxWidth, mode, &fit) == false || fit.truncated == false)
+            return "the text was not truncated";
+        if(width != fit.width || width > maxWidth)
+            return "the drawn width differs from MeasureFit or exceeds the maximum";
+
+        std::string fitted = std::string(kText, fit.headEnd) + "\xE2\x80\xA6" + std::string(kText + fit.tailBegin, fit.lineEnd - fit.tailBegin);
+        font.DrawText(fitted.c_str(), size, kColor, stringImage.pixels.data(), stringImage.width, 4, 4);
+        if(fitImage.pixels != stringImage.pixels)
+            return "the fitted text draws different pixels than its truncated string";
+    }
+
+    return "";
+}
+
+//-------------------------------------
+// A handle over the same face, with its own atlas or packing in the atlas of the font, draws the same pixels.
+// Loading a face reads the file and nothing else (each backend loads what it needs on first use).
+template <typename FontType>
+static std::string
+CheckFace(FontType &font, uint8_t size) {
+    Image image = NewImage(size);
+    font.DrawText(kText, size, kColor, image.pixels.data(), image.width, 4, 4);
+
+    MindShake::HeapAllocator heap;
+    MindShake::FontFace *face = MindShake::FontFace::Load(font.GetFace()->GetFontName().c_str(), &heap);
+    if(face == nullptr || face->GetStatus() != 1)
+        return "the face can't be loaded";
+    bool onlyFile = heap.GetUsedBytes() <= sizeof(MindShake::FontFace) + face->GetDataSize() + face->GetFontName().capacity() + 1;
+    face->Release();
+    if(onlyFile == false)
+        return "loading the face allocated more than the face and its file";
+
+    for(MindShake::AtlasManager *atlas : { static_cast<MindShake::AtlasManager *>(nullptr), font.GetAtlas() }) {
+        FontType faceFont(font.GetFace(), atlas);
+        int32_t  left, top, right, bottom;
+        font.GetClipping(&left, &top, &right, &bottom);
+        faceFont.SetClipping(left, top, right, bottom);
+        faceFont.SetAntialias(font.GetAntialias());
+        faceFont.SetAntialiasAllowEx(font.GetAntialiasAllowEx());
+        if(faceFont.GetStatus() != 1 || faceFont.GetFace() != font.GetFace())
+            return "a font over the face can't be created";
+
+        Image faceImage = NewImage(size);
+        faceFont.DrawText(kText, size, kColor, faceImage.pixels.data(), faceImage.width, 4, 4);
+        if(faceImage.pixels != image.pixels)
+            return atlas == nullptr ? "a font over the face draws different pixels" : "a font over the face sharing the atlas draws different pixels";
+        if(faceFont.Validate() == false || font.Validate() == false)
+            return "the atlas or the glyphs are not valid (see stderr)";
+    }
+
+    return "";
+}
+
+//-------------------------------------
+// The font without the digits, to make a collection fall back to the next one
+template <typename FontType>
+class FontWithoutDigits : public FontType {
+    public:
+        using FontType::FontType;
+
+    protected:
+        const MindShake::CodePointData &
+        GetCodePointData(uint32_t index) override {
+            static const MindShake::CodePointData missing {};
+            return index >= '0' && index <= '9' ? missing : FontType::GetCodePointData(index);
+        }
+};
+
+//-------------------------------------
+// A collection of only the font draws and measures like it (kerning included). One without the digits first falls
+// back to the font for them alone, and code points no font has are skipped.
+template <typename FontType>
+static std::string
+CheckCollection(FontType &font, uint8_t size) {
+    using Rect = MindShake::SkylineBinPack::Rect;
+
+    const char  *texts[] = { kText, "AVATAR Tj V\xC3\x81V", "0123456789" };
+    int32_t     left, top, right, bottom;
+
+    font.GetClipping(&left, &top, &right, &bottom);
+
+    FontType                    single(font.GetFace());
+    FontWithoutDigits<FontType> withoutDigits(font.GetFace());
+    FontType                    fallback(font.GetFace());
+    for(MindShake::Font *member : { static_cast<MindShake::Font *>(&single), static_cast<MindShake::Font *>(&withoutDigits), static_cast<MindShake::Font *>(&fallback) }) {
+        member->SetAntialias(font.GetAntialias());
+        member->SetAntialiasAllowEx(font.GetAntialiasAllowEx());
+    }
+
+    MindShake::FontCollection collection;
+    if(collection.AddFont(&single) == false)
+        return "the font can't be added to a collection";
+    collection.SetClipping(left, top, right, bottom);
+
+    for(const char *text : texts) {
+        Image image = NewImage(size);
+        font.DrawText(text, size, kColor, image.pixels.data(), image.width, 4, 4);
+        Image collectionImage = NewImage(size);
+        collection.DrawText(text, size, kColor, collectionImage.pixels.data(), collectionImage.width, 4, 4);
+        if(collectionImage.pixels != image.pixels)
+            return std::string("a collection of the font draws different pixels for '") + text + "'";
+
+        Rect box {}, collectionBox {};
+        font.GetTextBox(text, size, &box);
+        collection.GetTextBox(text, size, &collectionBox);
+        if(memcmp(&box, &collectionBox, sizeof(box)) != 0)
+            return std::string("a collection of the font gives a different box for '") + text + "'";
+    }
+
+    MindShake::FontCollection fallbacks;
+    if(fallbacks.AddFont(&withoutDigits) == false || fallbacks.AddFont(&fallback) == false)
+        return "the fonts can't be added to a collection";
+    fallbacks.SetClipping(left, top, right, bottom);
+    if(fallbacks.ResolveFont('A') != 0 || fallbacks.ResolveFont('5') != 1 || fallbacks.ResolveFont(0x4E00) != -1)
+        return "the code points don't resolve to the first font that has them";
+
+    // Only digits: all from the second font, as the font draws them
+    Image image = NewImage(size);
+    font.DrawText(texts[2], size, kColor, image.pixels.data(), image.width, 4, 4);
+    Image collectionImage = NewImage(size);
+    fallbacks.DrawText(texts[2], size, kColor, collectionImage.pixels.data(), collectionImage.width, 4, 4);
+    if(collectionImage.pixels != image.pixels)
+        return "the digits drawn by the fallback font differ";
+
+    // A code point no font has is skipped
+    collectionImage = NewImage(size);
+    fallbacks.DrawText("\xE4\xB8\x80" "0123456789", size, kColor, collectionImage.pixels.data(), collectionImage.width, 4, 4);
+    if(collectionImage.pixels != image.pixels)
+        return "a code point missing in every font is not skipped";
+
+    return "";
+}
+
+//-------------------------------------
+struct SceneNode {
+    const char  *text;
+    uint32_t    color;
+    int32_t     posX;
+    int32_t     posY;
+};
+
+//-------------------------------------
+// Marks the tiles of the buffer the text of the node covers, like TextScene does
+static void
+DamageSceneTiles(MindShake::Font &font, const SceneNode &node, uint8_t size, const Image &image, uint32_t tileSize, std::vector<uint8_t> &tiles) {
+    MindShake::SkylineBinPack::Rect box;
+
+    font.GetTextBox(node.text, size, &box);
+    int32_t left   = std::max(node.posX + box.x, 0);
+    int32_t top    = std::max(node.posY + box.y, 0);
+    int32_t right  = std::min(node.posX + box.width + 1, int32_t(image.width));
+    int32_t bottom = std::min(node.posY + box.height + 1, int32_t(image.height));
+    uint32_t tilesX = (image.width + tileSize - 1) / tileSize;
+    for(int32_t y = top; y < bottom; ++y) {
+        for(int32_t x = left; x < right; ++x) {
+            tiles[(uint32_t(y) / tileSize) * tilesX + uint32_t(x) / tileSize] = 1;
+        }
+    }
+}
+
+//-------------------------------------
+// A scene redraws exactly the tiles of the nodes that changed (a span per run of tiles, their union as the box)
+// and the buffer ends as drawing its nodes from scratch, in the order they were added, through moves, recolors,
+// removals and a removed id reused by a new node.
+template <typename FontType>
+static std::string
+CheckScene(FontType &font, uint8_t size) {
+    const uint32_t  tileSize = 16;
+    Image           image    = NewImage(size);
+    const uint32_t  tilesX   = (image.width + tileSize - 1) / tileSize;
+    const uint32_t  tilesY   = (image.height + tileSize - 1) / tileSize;
+    const int32_t   farX     = int32_t(image.width) - int32_t(size) * 3;
+
+    std::vector<SceneNode>  nodes = {
+        { "AVATAR",  kColor,     4,                           4                        },
+        { "Tj 0123", 0xff60d0f0, 4 + int32_t(size),           4 + int32_t(size) / 4    },
+        { "far",     0xffffffff, farX,                        int32_t(size) * 2        },
+    };
+    std::vector<uint32_t>   ids;
+
+    MindShake::TextScene scene(image.width, image.height, tileSize);
+    scene.SetBackgroundColor(kBackground);
+    for(const auto &node : nodes) {
+        ids.push_back(scene.AddNode(&font, node.text, size, node.color, node.posX, node.posY));
+    }
+
+    // The nodes, drawn from scratch in order, and the damage expected from the last change
+    std::vector<uint8_t> expectedTiles(tilesX * tilesY, 1);
+    auto check = [&](const char *step) -> std::string {
+        Image expected = NewImage(size);
+        for(const auto &node : nodes) {
+            font.DrawText(node.text, size, node.color, expected.pixels.data(), expected.width, node.posX, node.posY);
+        }
+
+        if(scene.Update(image.pixels.data(), image.width) == false)
+            return std::string(step) + ": nothing redrawn";
+
+        std::vector<uint8_t> tiles(tilesX * tilesY, 0);
+        MindShake::SkylineBinPack::Rect box { 0x7fffffff, 0x7fffffff, 0, 0 };
+        int32_t right = 0, bottom = 0;
+        for(const auto &rect : scene.GetDamagedRects()) {
+            if(rect.x % tileSize != 0 || rect.y % tileSize != 0 || rect.height > int32_t(tileSize))
+                return std::string(step) + ": a damaged span is not a run of tiles";
+            for(int32_t x = rect.x; x < rect.right(); x += tileSize) {
+                tiles[(rect.y / tileSize) * tilesX + x / tileSize] = 1;
+            }
+            box.x  = std::min(box.x, rect.x);
+            box.y  = std::min(box.y, rect.y);
+            right  = std::max(right, rect.right());
+            bottom = std::max(bottom, rect.bottom());
+        }
+        box.width  = right - box.x;
+        box.height = bottom - box.y;
+
+        const auto &damagedBox = scene.GetDamagedBox();
+        if(damagedBox.x != box.x || damagedBox.y != box.y || damagedBox.width != box.width || damagedBox.height != box.height)
+            return std::string(step) + ": the damaged box is not the union of the spans";
+        if(tiles != expectedTiles)
+            return std::string(step) + ": the damaged tiles are not the ones of the changed nodes";
+        if(image.pixels != expected.pixels)
+            return std::string(step) + ": the buffer differs from drawing the nodes from scratch";
+        if(scene.Update(image.pixels.data(), image.width))
+            return std::string(step) + ": redrawn without changes";
+
+        std::fill(expectedTiles.begin(), expectedTiles.end(), uint8_t(0));
+        return "";
+    };
+
+    std::string problem = check("first update");
+
+    // Moved: its old and new place
+    if(problem.empty()) {
+        DamageSceneTiles(font, nodes[1], size, image, tileSize, expectedTiles);
+        nodes[1].posX += int32_t(size) / 2;
+        nodes[1].posY += int32_t(size) / 3;
+        DamageSceneTiles(font, nodes[1], size, image, tileSize, expectedTiles);
+        scene.SetNodePosition(ids[1], nodes[1].posX, nodes[1].posY);
+        problem = check("move");
+    }
+
+    // Recolored: only its place
+    if(problem.empty()) {
+        nodes[2].color = 0xff20ff20;
+        DamageSceneTiles(font, nodes[2], size, image, tileSize, expectedTiles);
+        scene.SetNodeColor(ids[2], nodes[2].color);
+        problem = check("recolor");
+    }
+
+    // Removed, and its id reused by a node over the others: painted last
+    uint32_t removed = ids[0];
+    if(problem.empty()) {
+        DamageSceneTiles(font, nodes[0], size, image, tileSize, expectedTiles);
+        scene.RemoveNode(removed);
+        nodes.erase(nodes.begin());
+        ids.erase(ids.begin());
+        problem = check("remove");
+    }
+    if(problem.empty()) {
+        nodes.push_back({ "WWW", 0xfff040f0, 4 + int32_t(size) * 3 / 2, 4 + int32_t(size) / 2 });
+        DamageSceneTiles(font, nodes.back(), size, image, tileSize, expectedTiles);
+        uint32_t id = scene.AddNode(&font, nodes.back().text, size, nodes.back().color, nodes.back().posX, nodes.back().posY);
+        problem = check("add over");
+        if(problem.empty() && id != removed)
+            problem = "add over: the removed id was not reused";
+    }
+
+    return problem;
+}
+
+//-------------------------------------
+// Once warmed up, a font on an ArenaAllocator (its glyph cache and its atlas) draws and measures without allocating,
+// with and without the text cache
+template <typename FontType>
+static std::string
+CheckFrozen(FontType &font, uint8_t size) {
+    const char  *texts[] = { kText, "AVATAR Tj", "" };
+    int32_t     left, top, right, bottom;
+    Image       image = NewImage(size);
+
+    font.GetClipping(&left, &top, &right, &bottom);
+
+    // Frozen default allocator while creating the font, preloading and drawing the first frame: the atlas (packers
+    // included) must only use the arena
+    MindShake::FontAllocator  *previous = MindShake::FontAllocator::GetDefault();
+    MindShake::ArenaAllocator guard(1 << 20);
+    MindShake::ArenaAllocator arena(32 << 20);
+    guard.Freeze();
+    MindShake::FontAllocator::SetDefault(&guard);
+    FontType arenaFont(font.GetFace(), nullptr, &arena);
+    arenaFont.SetAntialias(font.GetAntialias());
+    arenaFont.SetAntialiasAllowEx(font.GetAntialiasAllowEx());
+    arenaFont.SetClipping(left, top, right, bottom);
+
+    auto frame = [&]() {
+        MindShake::SkylineBinPack::Rect box;
+        for(const char *text : texts) {
+            arenaFont.DrawText(text, size, kColor, image.pixels.data(), image.width, 4, 4);
+            arenaFont.GetTextBox(text, size, &box);
+        }
+        arenaFont.ConsumeDirtyRegions();
+    };
+
+    arenaFont.PreloadGlyphs("AVATAR", &size, 1);
+    frame();
+    MindShake::FontAllocator::SetDefault(previous);
+    if(guard.GetNumFrozenAllocations() != 0)
+        return "the atlas allocated from the default allocator";
+
+    for(uint32_t textCacheSize : { 0u, 64u << 10 }) {
+        arena.Unfreeze();
+        arenaFont.SetTextCacheSize(textCacheSize);
+        frame();
+        frame();
+
+        arena.Freeze();
+        for(int i = 0; i < 8; ++i) {
+            frame();
+        }
+        if(arena.GetNumFrozenAllocations() != 0)
+            return textCacheSize == 0 ? "drawing allocated once warmed up" : "drawing with the text cache allocated once warmed up";
+    }
+    arena.Unfreeze();
+
+    if(arena.GetNumFailedAllocations() != 0)
+        return "the arena ran out of memory";
+
+    return "";
+}
+
+//-------------------------------------
+template <typename FontType>
+static void
+RunCheck(const char *feature, CheckFunction<FontType> check, const char *backend, const char *fontName, uint8_t size, AAMode aa, int *pFailed) {
+    FontType font(fontName);
+    font.SetAntialias(aa != AAMode::None);
+    font.SetAntialiasAllowEx(aa == AAMode::AAEx);
+    font.SetClipping(0, 0, int32_t(kWidth), int32_t(NewImage(size).height));
+
+    std::string problem = check(font, size);
+    if(problem.empty() == false) {
+        printf("%s_%u_%s %s: FAILED (%s)\n", backend, size, GetAAName(aa), feature, problem.c_str());
+        ++(*pFailed);
+    }
+}
+
+//-------------------------------------
+template <typename FontType>
+static void
+RunChecks(const char *backend, const char *fontName, uint8_t size, AAMode aa, int *pFailed) {
+    RunCheck<FontType>("text cache", CheckTextCache<FontType>, backend, fontName, size, aa, pFailed);
+    RunCheck<FontType>("face", CheckFace<FontType>, backend, fontName, size, aa, pFailed);
+    RunCheck<FontType>("collection", CheckCollection<FontType>, backend, fontName, size, aa, pFailed);
+    RunCheck<FontType>("scene", CheckScene<FontType>, backend, fontName, size, aa, pFailed);
+    RunCheck<FontType>("frozen", CheckFrozen<FontType>, backend, fontName, size, aa, pFailed);
+    RunCheck<FontType>("fit", CheckFit<FontType>, backend, fontName, size, aa, pFailed);
+    RunCheck<FontType>("measure", CheckMeasure<FontType>, backend, fontName, size, aa, pFailed);
+    RunCheck<FontType>("effects", CheckEffects<FontType>, backend, fontName, size, aa, pFailed);
+}
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    const uint8_t   sizes[]      = { 12, 20, 36, 64 };
+    const AAMode    aaModes[]    = { AAMode::None, AAMode::AA, AAMode::AAEx };
+    const char      *fontName    = "../tests/resources/Lato-Regular.ttf";    // The font of the goldens
+    std::string     goldenDir    = "../tests/golden";
+    bool            update       = false;
+    int             failed       = 0;
+    int             failedChecks = 0;
+
+    int arg = 1;
+    if(arg < argc && strcmp(argv[arg], "--update") == 0) {
+        update = true;
+        ++arg;
+    }
+    if(arg < argc)
+        fontName = argv[arg++];
+    if(arg < argc)
+        goldenDir = argv[arg++];
+
+    if(IsLfsPointer(fontName)) {
+        printf("'%s' is a git LFS pointer (git lfs pull): skipped\n", fontName);
+        return kSkipped;
+    }
+
+    for(uint8_t size : sizes) {
+        for(AAMode aa : aaModes) {
+            for(int clip = 0; clip < 2; ++clip) {
+                if(RunCase<MindShake::FontSTB>("stb", fontName, goldenDir, update, size, aa, clip != 0, &failed) == false)
+                    return 2;
+                if(RunCase<MindShake::FontSFT>("sft", fontName, goldenDir, update, size, aa, clip != 0, &failed) == false)
+                    return 2;
+                if(RunCase<MindShake::FontACC>("acc", fontName, goldenDir, update, size, aa, clip != 0, &failed) == false)
+                    return 2;
+            }
+            RunChecks<MindShake::FontSTB>("stb", fontName, size, aa, &failedChecks);
+            RunChecks<MindShake::FontSFT>("sft", fontName, size, aa, &failedChecks);
+            RunChecks<MindShake::FontACC>("acc", fontName, size, aa, &failedChecks);
+            RunCheck<MindShake::FontACC>("coverage", CheckCoverage<MindShake::FontACC>, "acc", fontName, size, aa, &failedChecks);
+        }
+    }
+
+    if(failedChecks != 0) {
+        printf("%d feature checks failed\n", failedChecks);
+    }
+    if(failed != 0) {
+        printf("%d cases differ from the goldens or have none (see %s/*.actual.ppm)\n", failed, goldenDir.c_str());
+    }
+    if(failed != 0 || failedChecks != 0)
+        return 1;
+
+    return 0;
+}
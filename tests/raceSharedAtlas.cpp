@@ -0,0 +1,263 @@
+#include <FontSTB.h>
+#include <SharedAtlas.h>
+//-------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+//-------------------------------------
+#include <sys/wait.h>
+#include <unistd.h>
+
+//-------------------------------------
+// A producer process publishes the glyphs of a text in a SharedAtlas and a forked consumer draws it:
+//  1. Published: SharedAtlas::DrawText succeeds and gives the pixels of Font::DrawText. A text with a glyph
+//     not published fails without touching dst.
+//  2. After Reset: it fails (the glyphs are gone) without touching dst.
+//  3. The producer loops Publish / Reset while the consumer draws: a draw that succeeds gives the pixels
+//     of Font::DrawText, a draw racing a Reset fails. Both must happen a few times. A failed draw that
+//     touched dst (a reset while blitting) is cleared and drawn again with the font, as documented.
+// Exits with kSkipped when the font is only a git LFS pointer (git lfs pull).
+//
+// raceSharedAtlas [font.ttf]
+//-------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+static const char       *kText      = "The quick brown fox\njumps over 0123456789\nAVATAR Tj {[(;:!?)]}";
+// Also one glyph: a reset can only tear the last glyph drawn, unseen if a later one is missing
+static const char       *kTexts[]   = { kText, "T" };
+static const uint32_t   kNumTexts   = sizeof(kTexts) / sizeof(kTexts[0]);
+static const char       *kUnpublished = "TW";   // No W in kText
+static const uint8_t    kHeights[]  = { 12, 20, 36 };
+static const uint32_t   kNumHeights = sizeof(kHeights) / sizeof(kHeights[0]);
+static const uint8_t    kFontId     = 1;
+static const uint32_t   kColor      = 0xfff0d060;
+static const uint32_t   kBackground = 0xff102030;
+static const uint32_t   kWidth      = 480;
+static const uint32_t   kHeight     = 160;
+static const uint32_t   kMinDraws   = 200;      // Of each kind in the race
+static const double     kMinSeconds = 2.0;      // Race at least this long (a torn glyph is rare)
+static const double     kMaxSeconds = 20.0;
+
+// ctest SKIP_RETURN_CODE
+static const int        kSkipped = 77;
+
+//-------------------------------------
+static bool
+IsLfsPointer(const char *fileName) {
+    const char  prefix[] = "version https://git-lfs";
+    char        buffer[sizeof(prefix) - 1];
+
+    FILE *file = fopen(fileName, "rb");
+    if(file == nullptr)
+        return false;
+    bool isPointer = fread(buffer, 1, sizeof(buffer), file) == sizeof(buffer) && memcmp(buffer, prefix, sizeof(buffer)) == 0;
+    fclose(file);
+
+    return isPointer;
+}
+
+//-------------------------------------
+static void
+Signal(int fd) {
+    char value = 1;
+    if(write(fd, &value, 1) != 1) {
+        fprintf(stderr, "Can't write to the pipe\n");
+    }
+}
+
+//-------------------------------------
+static bool
+Wait(int fd) {
+    char value;
+    return read(fd, &value, 1) == 1;
+}
+
+//-------------------------------------
+// Draws text at height with the shared atlas, or with the font if shared is nullptr
+static bool
+Draw(MindShake::Font &font, const MindShake::SharedAtlas *shared, const char *text, uint8_t height, std::vector<uint32_t> &pixels) {
+    pixels.assign(kWidth * kHeight, kBackground);
+    if(shared == nullptr) {
+        font.DrawText(text, height, kColor, pixels.data(), kWidth, 4, 4);
+        return true;
+    }
+
+    return shared->DrawText(font, kFontId, text, height, kColor, pixels.data(), kWidth, 4, 4);
+}
+
+//-------------------------------------
+// Returns the exit code of the child
+static int
+RunConsumer(const char *name, const char *fontName, int fdWait, int fdSignal) {
+    MindShake::SharedAtlas shared;
+    MindShake::FontSTB     font(fontName);
+    std::vector<uint32_t>  expected[kNumTexts][kNumHeights];
+    std::vector<uint32_t>  pixels;
+    std::vector<uint32_t>  blank(kWidth * kHeight, kBackground);
+    uint32_t               numDrawn    = 0;
+    uint32_t               numRejected = 0;
+    uint32_t               numTorn     = 0;
+    int                    result      = 0;
+
+    if(int8_t(font.GetStatus()) < 0 || shared.Open(name) == false)
+        return 2;
+    font.SetClipping(0, 0, int32_t(kWidth), int32_t(kHeight));
+
+    for(uint32_t t=0; t<kNumTexts; ++t) {
+        for(uint32_t i=0; i<kNumHeights; ++i) {
+            Draw(font, nullptr, kTexts[t], kHeights[i], expected[t][i]);
+        }
+    }
+
+    // 1. Published
+    for(uint32_t t=0; t<kNumTexts; ++t) {
+        for(uint32_t i=0; i<kNumHeights; ++i) {
+            if(Draw(font, &shared, kTexts[t], kHeights[i], pixels) == false) {
+                printf("published_%u_%u: FAILED (draw failed)\n", t, kHeights[i]);
+                result = 1;
+            }
+            else if(pixels != expected[t][i]) {
+                printf("published_%u_%u: FAILED (pixels differ from Font::DrawText)\n", t, kHeights[i]);
+                result = 1;
+            }
+        }
+    }
+    if(Draw(font, &shared, kUnpublished, kHeights[0], pixels) || pixels != blank) {
+        printf("unpublished: FAILED (%s)\n", pixels != blank ? "dst touched" : "drawn without glyphs");
+        result = 1;
+    }
+    Signal(fdSignal);
+
+    // 2. Reset
+    if(Wait(fdWait) == false)
+        return 2;
+    for(uint32_t t=0; t<kNumTexts; ++t) {
+        for(uint32_t i=0; i<kNumHeights; ++i) {
+            if(Draw(font, &shared, kTexts[t], kHeights[i], pixels) || pixels != blank) {
+                printf("reset_%u_%u: FAILED (%s)\n", t, kHeights[i], pixels != blank ? "dst touched" : "drawn without glyphs");
+                result = 1;
+            }
+        }
+    }
+    Signal(fdSignal);
+
+    // 3. Race
+    Clock::time_point start = Clock::now();
+    for(uint32_t n=0; ; ++n) {
+        uint32_t t = n % kNumTexts;
+        uint32_t i = (n / kNumTexts) % kNumHeights;
+        double   seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if(seconds >= kMinSeconds && numDrawn >= kMinDraws && numRejected >= kMinDraws)
+            break;
+        if(seconds > kMaxSeconds) {
+            printf("race: FAILED (%u draws succeeded and %u failed in %.0f s)\n", numDrawn, numRejected, kMaxSeconds);
+            result = 1;
+            break;
+        }
+
+        if(Draw(font, &shared, kTexts[t], kHeights[i], pixels) == false) {
+            ++numRejected;
+            if(pixels != blank) {
+                // Reset while blitting: clear and draw again
+                ++numTorn;
+                Draw(font, nullptr, kTexts[t], kHeights[i], pixels);
+                if(pixels != expected[t][i]) {
+                    printf("race_%u_%u: FAILED (the redraw differs from Font::DrawText)\n", t, kHeights[i]);
+                    result = 1;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        ++numDrawn;
+        if(pixels != expected[t][i]) {
+            printf("race_%u_%u: FAILED (a draw racing a reset succeeded)\n", t, kHeights[i]);
+            result = 1;
+            break;
+        }
+    }
+    if(result == 0) {
+        printf("race: %u draws succeeded, %u failed (%u after touching dst)\n", numDrawn, numRejected, numTorn);
+    }
+
+    return result;
+}
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    const char  *fontName = "resources/Roboto-Regular.ttf";
+    int         toConsumer[2];
+    int         toProducer[2];
+    int         status   = 0;
+    pid_t       ended    = 0;
+
+    if(argc > 1)
+        fontName = argv[1];
+
+    if(IsLfsPointer(fontName)) {
+        printf("'%s' is a git LFS pointer (git lfs pull): skipped\n", fontName);
+        return kSkipped;
+    }
+
+    MindShake::FontSTB font(fontName);
+    if(int8_t(font.GetStatus()) < 0)
+        return 2;
+
+    std::string name = "/raceSharedAtlas_" + std::to_string(getpid());
+    MindShake::SharedAtlas shared;
+    if(shared.Create(name.c_str(), 1024, 1024, 4096) == false)
+        return 2;
+
+    uint32_t numGlyphs = shared.Publish(font, kFontId, kText, kHeights, kNumHeights);
+    if(numGlyphs == 0) {
+        fprintf(stderr, "Nothing published\n");
+        return 2;
+    }
+
+    if(pipe(toConsumer) != 0 || pipe(toProducer) != 0) {
+        fprintf(stderr, "Can't create the pipes\n");
+        return 2;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0) {
+        fprintf(stderr, "Can't fork\n");
+        return 2;
+    }
+    if(pid == 0) {
+        // Skip the destructors of the producer (they would remove the segment)
+        int result = RunConsumer(name.c_str(), fontName, toConsumer[0], toProducer[1]);
+        fflush(stdout);
+        _exit(result);
+    }
+
+    // 2. Reset once the consumer drew the published glyphs
+    if(Wait(toProducer[0])) {
+        shared.Reset();
+        Signal(toConsumer[1]);
+
+        // 3. Race until the consumer ends
+        if(Wait(toProducer[0])) {
+            while((ended = waitpid(pid, &status, WNOHANG)) == 0) {
+                shared.Publish(font, kFontId, kText, kHeights, kNumHeights);
+                shared.Reset();
+            }
+        }
+    }
+
+    if(ended == 0) {
+        ended = waitpid(pid, &status, 0);
+    }
+
+    int result = ended == pid && WIFEXITED(status) ? WEXITSTATUS(status) : 2;
+    printf("%u glyphs published: %s\n", numGlyphs, result == 0 ? "ok" : "FAILED");
+
+    return result;
+}
@@ -0,0 +1,371 @@
+#include <FontSFT.h>
+#include <FontSTB.h>
+//-------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+//-------------------------------------
+#if defined(__linux__)
+    #include <unistd.h>
+#endif
+
+//-------------------------------------
+// Random mix of DrawText (some with effects or fitted), GetTextBox (batched, and carets), PreloadGlyphs, ReleaseHeight + RepackAtlas, Reset and option
+// changes, checking the atlas and the glyph cache every so often. Prints the throughput of each epoch.
+// Built with FONT_RENDERER_STATS it first checks the stats against draws with known counts.
+//
+// stressAtlas [codePoints] [font.ttf] [seed]
+//-------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+static const uint32_t   kWidth          = 640;
+static const uint32_t   kHeight         = 480;
+static const uint64_t   kAtlasBudget    = 16 << 20;     // The "application" resets the font beyond it
+static const uint64_t   kEpochCodePoints = 100000;
+static const uint32_t   kValidateEvery  = 2000;         // Operations
+
+//-------------------------------------
+static uint32_t gSeed = 1;
+
+static uint32_t
+Random(uint32_t range) {
+    gSeed = gSeed * 1664525u + 1013904223u;
+    return (gSeed >> 8) % range;
+}
+
+//-------------------------------------
+static void
+AppendUTF8(std::string &text, uint32_t codePoint) {
+    if(codePoint < 0x80) {
+        text += char(codePoint);
+    }
+    else if(codePoint < 0x800) {
+        text += char(0xC0 | (codePoint >> 6));
+        text += char(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        text += char(0xE0 | (codePoint >> 12));
+        text += char(0x80 | ((codePoint >> 6) & 0x3F));
+        text += char(0x80 | (codePoint & 0x3F));
+    }
+}
+
+//-------------------------------------
+// Mostly scripts the font has, some code points it has not (CJK, any BMP)
+static uint32_t
+RandomCodePoint() {
+    switch(Random(8)) {
+        case 0:
+        case 1:
+        case 2:     return 0x20 + Random(0x5F);
+        case 3:     return 0xA0 + Random(0x60);
+        case 4:     return 0x100 + Random(0x80);
+        case 5:     return Random(2) ? 0x391 + Random(0x38) : 0x410 + Random(0x40);
+        case 6:     return 0x4E00 + Random(0x200);
+        default:    return 0x21 + Random(0xD7E0);
+    }
+}
+
+//-------------------------------------
+static uint8_t
+RandomHeight() {
+    return uint8_t(Random(4) == 0 ? 6 + Random(123) : 10 + 2 * Random(12));
+}
+
+//-------------------------------------
+static size_t
+GetResidentBytes() {
+#if defined(__linux__)
+    long pages = 0, resident = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+    if(file != nullptr) {
+        if(fscanf(file, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(file);
+    }
+    return size_t(resident) * size_t(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+//-------------------------------------
+// Every caret is found back from its position, the offsets walk the whole text and a full selection has a rect per line
+static bool
+CheckCarets(MindShake::Font &font, const std::string &text, uint32_t length, uint8_t height) {
+    MindShake::CaretLayout layout;
+    font.LayoutCarets(text.c_str(), height, &layout);
+
+    uint32_t lines = 1;
+    for(char c : text) {
+        lines += c == '\n';
+    }
+    if(layout.GetNumCarets() != length + 1 || layout.GetNumLines() != lines || layout.GetByteOffset(length) != text.size()) {
+        fprintf(stderr, "Carets: %u for %u code points, %u lines for %u\n", layout.GetNumCarets(), length, layout.GetNumLines(), lines);
+        return false;
+    }
+
+    for(uint32_t i = 0; i <= length; ++i) {
+        uint32_t line  = layout.GetLine(i);
+        uint32_t found = layout.GetIndexAt(layout.GetX(i), int32_t(line) * layout.GetLineHeight());
+        if(layout.GetX(found) != layout.GetX(i) || layout.GetLine(found) != line || (i > 0 && layout.GetByteOffset(i) <= layout.GetByteOffset(i - 1))) {
+            fprintf(stderr, "Caret %u (x %d, line %u) found as %u (x %d, line %u)\n", i, layout.GetX(i), line, found, layout.GetX(found), layout.GetLine(found));
+            return false;
+        }
+    }
+
+    std::vector<MindShake::CaretLayout::Rect> rects(lines);
+    if(layout.GetSelectionRects(length, 0, rects.data(), lines) != lines) {
+        fprintf(stderr, "Selection of %u lines\n", lines);
+        return false;
+    }
+
+    return true;
+}
+
+#if FONT_RENDERER_STATS
+//-------------------------------------
+static void
+CountRasterized(MindShake::EFontEvent event, int32_t glyph, uint8_t height, uint64_t durationNs, void *userData) {
+    if(event == MindShake::EFontEvent::Rasterize) {
+        ++*static_cast<uint32_t *>(userData);
+    }
+}
+
+//-------------------------------------
+// FontStats and the event callback after draws with known counts
+template <typename FontType>
+static bool
+CheckStats(const char *backend, const char *fontName) {
+    const uint8_t           height = 20;
+    const uint32_t          color  = 0xffffffff;
+    std::vector<uint32_t>   buffer(kWidth * kHeight);
+    uint32_t                numRasterized = 0;
+
+    FontType font(fontName);
+    if(int8_t(font.GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        return false;
+    }
+    font.SetClipping(0, 0, int32_t(kWidth), int32_t(kHeight));
+    font.SetEventCallback(CountRasterized, &numRasterized);
+    const MindShake::FontStats &stats = font.GetStats();
+
+    auto failed = [backend](const char *problem) {
+        fprintf(stderr, "%s stats: %s\n", backend, problem);
+        return false;
+    };
+
+    // 6 glyphs (4 different ones) and 6 kerning lookups (the last one with the end of the text) per draw
+    for(uint64_t draws = 1; draws <= 2; ++draws) {
+        font.DrawText("AVATAR", height, color, buffer.data(), kWidth, 10, 10);
+        if(stats.drawCalls != draws || stats.glyphsDrawn != 6 * draws)
+            return failed("wrong draw calls or glyphs drawn");
+        if(stats.glyphMisses != 4 || stats.glyphHits != 6 * draws - 4)
+            return failed("wrong glyph hits or misses");
+        if(stats.kerningHits + stats.kerningMisses != 6 * draws)
+            return failed("wrong kerning lookups");
+        if(numRasterized != 4 || stats.rasterizeTime.count != 4)
+            return failed("wrong rasterize events");
+    }
+
+    // The text blends the bytes of its glyphs
+    uint64_t textBytes  = stats.bytesBlended / 2;
+    uint64_t glyphBytes = 0;
+    for(const char *glyph : { "A", "V", "A", "T", "A", "R" }) {
+        font.ResetStats();
+        font.DrawText(glyph, height, color, buffer.data(), kWidth, 10, 10);
+        glyphBytes += stats.bytesBlended;
+    }
+    if(textBytes == 0 || textBytes != glyphBytes)
+        return failed("the bytes blended by the text are not the bytes of its glyphs");
+
+    // A cell with a background writes all its pixels, with or without a glyph, and only the glyph is drawn
+    uint32_t cellWidth, cellHeight;
+    font.GetCellSize(height, &cellWidth, &cellHeight);
+    const MindShake::Cell cells[] = { { 'A', color, 0xff000000 }, { ' ', color, 0xff000000 } };
+    font.ResetStats();
+    font.DrawCells(cells, 2, 1, height, buffer.data(), kWidth, 0, 0);
+    if(stats.glyphsDrawn != 1 || stats.bytesBlended != 2ull * cellWidth * cellHeight * sizeof(uint32_t))
+        return failed("wrong glyphs drawn or bytes of the cells");
+
+    return true;
+}
+#endif
+
+//-------------------------------------
+template <typename FontType>
+static bool
+Run(const char *backend, const char *fontName, uint64_t numCodePoints) {
+    FontType font(fontName);
+    if(int8_t(font.GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        return false;
+    }
+
+    std::vector<uint32_t>   buffer(kWidth * kHeight);
+    std::string             text;
+    uint32_t                length = 0;
+    uint64_t                codePoints = 0;
+    uint64_t                epochCodePoints = 0;
+    uint32_t                operations = 0;
+    uint32_t                resets = 0;
+    uint32_t                epoch = 0;
+    auto                    epochStart = Clock::now();
+
+    // A font reset and repacked is back to a single empty page of the initial size
+    auto resetFont = [&font, &resets]() {
+        font.Reset();
+        font.RepackAtlas(0.0f);
+        ++resets;
+
+        auto stats = font.GetAtlas()->GetStats();
+        if(stats.numRegions != 0 || stats.numPages != 1 || stats.textureBytes > uint64_t(font.GetTextureWidth()) * 128) {
+            fprintf(stderr, "Reset leaves %u regions in %u pages (%llu bytes)\n", stats.numRegions, stats.numPages, (unsigned long long) stats.textureBytes);
+            return false;
+        }
+        return true;
+    };
+
+    while(codePoints < numCodePoints) {
+        uint32_t operation = Random(100);
+        uint8_t  height    = RandomHeight();
+
+        // Some texts repeat (text cache hits)
+        if(Random(4) != 0 || text.empty()) {
+            text.clear();
+            length = 1 + Random(40);
+            for(uint32_t i = 0; i < length; ++i) {
+                AppendUTF8(text, Random(20) == 0 ? '\n' : RandomCodePoint());
+            }
+        }
+
+        if(operation < 55) {
+            int32_t left = int32_t(Random(kWidth / 2));
+            int32_t top  = int32_t(Random(kHeight / 2));
+            font.SetClipping(left, top, left + 1 + int32_t(Random(kWidth - left)), top + 1 + int32_t(Random(kHeight - top)));
+            // Some with an effect (its variants share the atlas with the glyphs)
+            if(Random(8) == 0) {
+                MindShake::TextEffect effect { MindShake::ETextEffect(1 + Random(3)), uint8_t(Random(5)), 0xff000000, int32_t(Random(5)) - 2, int32_t(Random(5)) - 2 };
+                font.DrawText(text.c_str(), height, 0xff000000 | Random(0x1000000), effect, buffer.data(), kWidth, int32_t(Random(kWidth + 64)) - 64, int32_t(Random(kHeight + 64)) - 64);
+            }
+            // Some fitted in a cell
+            else if(Random(8) == 0) {
+                int32_t maxWidth = int32_t(Random(kWidth / 2));
+                int32_t width    = font.DrawTextFit(text.c_str(), height, maxWidth, MindShake::ETruncate(Random(3)), 0xff000000 | Random(0x1000000), buffer.data(), kWidth, int32_t(Random(kWidth + 64)) - 64, int32_t(Random(kHeight + 64)) - 64);
+                if(width > maxWidth) {
+                    fprintf(stderr, "Fitted text of %d pixels in %d\n", width, maxWidth);
+                    return false;
+                }
+            }
+            else {
+                font.DrawText(text.c_str(), height, 0xff000000 | Random(0x1000000), buffer.data(), kWidth, int32_t(Random(kWidth + 64)) - 64, int32_t(Random(kHeight + 64)) - 64);
+            }
+            codePoints += length;
+        }
+        else if(operation < 80) {
+            MindShake::SkylineBinPack::Rect box;
+            font.GetTextBox(text.c_str(), height, &box);
+            if(Random(8) == 0) {
+                // The same box measured by a batch in several threads
+                const char *texts[] = { "", text.c_str(), text.c_str() };
+                MindShake::SkylineBinPack::Rect boxes[3];
+                font.GetTextBoxes(texts, 3, height, boxes, 1 + Random(3));
+                if(memcmp(&boxes[2], &box, sizeof(box)) != 0) {
+                    fprintf(stderr, "Batch box %d %d %d %d instead of %d %d %d %d\n", boxes[2].x, boxes[2].y, boxes[2].width, boxes[2].height, box.x, box.y, box.width, box.height);
+                    return false;
+                }
+            }
+            if(Random(4) == 0 && CheckCarets(font, text, length, height) == false)
+                return false;
+            codePoints += length;
+        }
+        else if(operation < 85) {
+            const uint8_t heights[] = { height, RandomHeight() };
+            font.PreloadGlyphs(text.c_str(), heights, 2);
+            codePoints += length * 2;
+        }
+        else if(operation < 92) {
+            font.ReleaseHeight(height);
+            font.RepackAtlas(Random(2) ? 0.0f : 0.05f);
+        }
+        else if(operation < 94) {
+            // Glyphs are cached per antialias settings
+            font.SetAntialias(Random(2) != 0);
+            font.SetAntialiasAllowEx(Random(2) != 0);
+            if(Random(4) == 0)
+                font.SetAntialiasWeights(Random(2) ? 20 : 1, Random(2) ? 4 : 1, 1);
+            if(Random(4) == 0)
+                font.ReleaseOtherRenderConfigs();
+        }
+        else if(operation < 97) {
+            font.SetGlyphRotation(Random(2) != 0);
+            font.SetPackingWasteMap(Random(2) != 0);
+            font.SetTextCacheSize(Random(2) ? 0 : Random(64 << 10));
+        }
+        else if(operation < 98) {
+            if(resetFont() == false)
+                return false;
+        }
+
+        // Bounded memory
+        auto stats = font.GetAtlas()->GetStats();
+        if(stats.textureBytes > kAtlasBudget) {
+            if(resetFont() == false)
+                return false;
+        }
+
+        if(++operations % kValidateEvery == 0 || codePoints >= numCodePoints) {
+            if(font.Validate() == false) {
+                fprintf(stderr, "%s: invalid state after %u operations\n", backend, operations);
+                return false;
+            }
+        }
+
+        if(codePoints - epochCodePoints >= kEpochCodePoints || codePoints >= numCodePoints) {
+            std::chrono::duration<double> elapsed = Clock::now() - epochStart;
+            stats = font.GetAtlas()->GetStats();
+            printf("%s epoch %3u  %9.0f code points/s  pages %u  atlas %6.2f MB  occupancy %5.1f%%  resets %u  text cache hits %5.1f%%  rss %6.1f MB\n",
+                   backend, epoch, double(codePoints - epochCodePoints) / elapsed.count(), stats.numPages,
+                   stats.textureBytes / (1024.0 * 1024.0), 100.0 * font.GetAtlas()->GetOccupancy(), resets,
+                   100.0 * font.GetTextCacheStats().GetHitRate(), GetResidentBytes() / (1024.0 * 1024.0));
+            fflush(stdout);
+
+            epochCodePoints = codePoints;
+            epochStart      = Clock::now();
+            ++epoch;
+        }
+    }
+
+    return true;
+}
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    uint64_t    numCodePoints = 2000000;
+    const char  *fontName     = "resources/Roboto-Regular.ttf";
+
+    if(argc > 1)
+        numCodePoints = strtoull(argv[1], nullptr, 10);
+    if(argc > 2)
+        fontName = argv[2];
+    if(argc > 3)
+        gSeed = uint32_t(strtoul(argv[3], nullptr, 10));
+
+#if FONT_RENDERER_STATS
+    if(CheckStats<MindShake::FontSTB>("STB", fontName) == false || CheckStats<MindShake::FontSFT>("SFT", fontName) == false)
+        return 1;
+#endif
+
+    if(Run<MindShake::FontSTB>("STB", fontName, numCodePoints) == false)
+        return 1;
+    if(Run<MindShake::FontSFT>("SFT", fontName, numCodePoints) == false)
+        return 1;
+
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include <FontSFT.h>
+#include <FontSTB.h>
+#include <FontTrace.h>
+//-------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+//-------------------------------------
+// Traces a preload and enough draws to flush the event blocks more than once, then parses the trace file
+// (strict JSON) and checks the events it holds. An empty trace must parse too.
+// Needs a FONT_RENDERER_TRACE build, otherwise exits with kSkipped.
+//
+// traceRender [font.ttf] [trace.json]
+//-------------------------------------
+
+static const int        kSkipped  = 77;
+static const uint32_t   kWidth    = 320;
+static const uint32_t   kHeight   = 64;
+static const uint32_t   kDraws    = 40000;      // Over 2 blocks of 16384 events
+static const uint8_t    kHeight1  = 20;
+static const uint8_t    kHeight2  = 32;
+
+//-------------------------------------
+// Minimal JSON reader: checks the syntax and collects the name of each trace event
+class TraceParser {
+    public:
+        explicit    TraceParser(const std::string &text) : mText(text) { }
+
+        bool
+        Parse() {
+            SkipSpaces();
+            if(ParseTrace() == false)
+                return Fail("bad trace");
+            SkipSpaces();
+            if(mPos != mText.size())
+                return Fail("text after the trace");
+            return true;
+        }
+
+        const std::map<std::string, uint32_t> &
+        GetNames() const                { return mNames;     }
+        uint32_t
+        GetNumEvents() const            { return mNumEvents; }
+
+    protected:
+        void
+        SkipSpaces() {
+            while(mPos < mText.size() && strchr(" \t\r\n", mText[mPos]) != nullptr)
+                ++mPos;
+        }
+
+        bool
+        Expect(char c) {
+            SkipSpaces();
+            if(mPos >= mText.size() || mText[mPos] != c)
+                return false;
+            ++mPos;
+            return true;
+        }
+
+        bool
+        Peek(char c) {
+            SkipSpaces();
+            return mPos < mText.size() && mText[mPos] == c;
+        }
+
+        bool
+        ParseString(std::string *value) {
+            if(Expect('"') == false)
+                return false;
+            value->clear();
+            while(mPos < mText.size() && mText[mPos] != '"') {
+                if(mText[mPos] == '\\' || uint8_t(mText[mPos]) < 0x20)
+                    return false;   // The writer never escapes
+                *value += mText[mPos++];
+            }
+            return Expect('"');
+        }
+
+        bool
+        ParseNumber() {
+            SkipSpaces();
+            const char *begin = mText.c_str() + mPos;
+            char       *end   = nullptr;
+            strtod(begin, &end);
+            if(end == begin || strchr("-0123456789", *begin) == nullptr)
+                return false;
+            mPos += size_t(end - begin);
+            return true;
+        }
+
+        // {"key":value,...} with numbers or objects as values, the name as a string
+        bool
+        ParseObject(std::string *name) {
+            std::string key, value;
+
+            if(Expect('{') == false)
+                return false;
+            if(Expect('}'))
+                return true;
+            do {
+                if(ParseString(&key) == false || Expect(':') == false)
+                    return false;
+                if(Peek('{')) {
+                    if(ParseObject(nullptr) == false)
+                        return false;
+                }
+                else if(Peek('"')) {
+                    if(ParseString(&value) == false)
+                        return false;
+                    if(key == "name" && name != nullptr)
+                        *name = value;
+                }
+                else if(ParseNumber() == false) {
+                    return false;
+                }
+            } while(Expect(','));
+            return Expect('}');
+        }
+
+        // {"traceEvents":[event,...]}
+        bool
+        ParseTrace() {
+            std::string key, name;
+
+            if(Expect('{') == false || ParseString(&key) == false || key != "traceEvents" || Expect(':') == false || Expect('[') == false)
+                return false;
+            if(Expect(']'))
+                return Expect('}');
+            do {
+                name.clear();
+                if(ParseObject(&name) == false || name.empty())
+                    return false;
+                ++mNames[name];
+                ++mNumEvents;
+            } while(Expect(','));
+            return Expect(']') && Expect('}');
+        }
+
+        bool
+        Fail(const char *problem) {
+            fprintf(stderr, "Trace parse error (%s) at byte %zu\n", problem, mPos);
+            return false;
+        }
+
+    protected:
+        const std::string               &mText;
+        size_t                          mPos {};
+        std::map<std::string, uint32_t> mNames;
+        uint32_t                        mNumEvents {};
+};
+
+//-------------------------------------
+static bool
+ReadFile(const char *fileName, std::string *text) {
+    FILE *file = fopen(fileName, "rb");
+    if(file == nullptr) {
+        fprintf(stderr, "Can't open '%s'\n", fileName);
+        return false;
+    }
+
+    char    buffer[4096];
+    size_t  read;
+    text->clear();
+    while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text->append(buffer, read);
+    fclose(file);
+
+    return true;
+}
+
+//-------------------------------------
+static uint32_t
+Count(const std::map<std::string, uint32_t> &names, const char *name) {
+    auto it = names.find(name);
+    return it != names.end() ? it->second : 0;
+}
+
+//-------------------------------------
+static bool
+CheckEmpty(const char *traceName) {
+    std::string text;
+
+    if(MindShake::FontTrace::Begin(traceName) == false)
+        return false;
+    MindShake::FontTrace::End();
+
+    if(ReadFile(traceName, &text) == false)
+        return false;
+    TraceParser parser(text);
+    if(parser.Parse() == false || parser.GetNumEvents() != 0) {
+        fprintf(stderr, "The empty trace is wrong\n");
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+static bool
+CheckDraws(const char *fontName, const char *traceName) {
+    std::vector<uint32_t>   buffer(kWidth * kHeight);
+    std::string             text;
+
+    MindShake::FontSTB stbFont(fontName);
+    MindShake::FontSFT sftFont(fontName);
+    if(int8_t(stbFont.GetStatus()) < 0 || int8_t(sftFont.GetStatus()) < 0) {
+        fprintf(stderr, "Can't load '%s'\n", fontName);
+        return false;
+    }
+    stbFont.SetClipping(0, 0, int32_t(kWidth), int32_t(kHeight));
+    sftFont.SetClipping(0, 0, int32_t(kWidth), int32_t(kHeight));
+
+    // Not traced
+    stbFont.DrawText("AVATAR", kHeight2, 0xffffffff, buffer.data(), kWidth, 4, 4);
+
+    if(MindShake::FontTrace::Begin(traceName) == false)
+        return false;
+
+    // 4 different glyphs preloaded, then drawn from the cache
+    stbFont.PreloadGlyphs("AVATAR", &kHeight1, 1);
+    for(uint32_t i=0; i<kDraws; ++i) {
+        stbFont.DrawText("AVATAR", kHeight1, 0xffffffff, buffer.data(), kWidth, 4, 4);
+    }
+    // 4 misses
+    sftFont.DrawText("AVATAR", kHeight1, 0xffffffff, buffer.data(), kWidth, 4, 4);
+
+    MindShake::FontTrace::End();
+
+    // Not traced
+    stbFont.DrawText("AVATAR", kHeight1, 0xffffffff, buffer.data(), kWidth, 4, 4);
+
+    if(ReadFile(traceName, &text) == false)
+        return false;
+    TraceParser parser(text);
+    if(parser.Parse() == false)
+        return false;
+
+    struct Expected {
+        const char  *name;
+        uint32_t    count;
+    };
+    const Expected expected[] = {
+        { "PreloadGlyphs",      1               },
+        { "DecodeAndMeasure",   1               },
+        { "AtlasAllocateBatch", 1               },
+        { "stbtt_Rasterize",    4               },
+        { "DrawText",           kDraws + 1      },
+        { "GlyphMiss",          4               },
+        { "sft_render",         4               },
+        { "CopyGlyphToAtlas",   8               },
+    };
+
+    bool ok = true;
+    for(const Expected &event : expected) {
+        uint32_t count = Count(parser.GetNames(), event.name);
+        if(count != event.count) {
+            fprintf(stderr, "'%s': %u events, expected %u\n", event.name, count, event.count);
+            ok = false;
+        }
+    }
+    printf("%u events traced\n", parser.GetNumEvents());
+
+    return ok;
+}
+
+//-------------------------------------
+int
+main(int argc, char *argv[]) {
+    const char *fontName  = argc > 1 ? argv[1] : "../tests/resources/Lato-Regular.ttf";
+    const char *traceName = argc > 2 ? argv[2] : "traceRender.json";
+
+#if !FONT_RENDERER_TRACE
+    (void) fontName;
+    (void) traceName;
+    printf("Built without FONT_RENDERER_TRACE: skipped\n");
+    return kSkipped;
+#else
+    if(CheckEmpty(traceName) == false || CheckDraws(fontName, traceName) == false)
+        return 1;
+
+    remove(traceName);
+    return 0;
+#endif
+}